@@ -11,17 +11,63 @@
 
 namespace infini
 {
+struct AllocatorStats
+{
+    // bytes actually allocated by getPtr(), 0 before it is called. May be
+    // larger than `peak` after a re-plan for smaller shapes.
+    size_t arenaSize;
+    // bytes the arena needs for the plan so far
+    size_t peak;
+    // bytes currently allocated
+    size_t used;
+    // highest number of bytes allocated at the same time
+    size_t maxUsed;
+    // number of alloc() calls and the sum of their (aligned) sizes
+    size_t numAllocs;
+    size_t requested;
+    // current free blocks below the top of the arena
+    size_t numFreeBlocks;
+    size_t freeBytes;
+    size_t largestFreeBlock;
+    // free block count per size class: key is the smallest power of two that
+    // is not less than the block size
+    std::map<size_t, size_t> freeBlockHistogram;
+
+    // share of the free bytes not usable by an allocation of `freeBytes`
+    double fragmentation() const
+    {
+        return freeBytes == 0 ? 0. : 1. - double(largestFreeBlock) / freeBytes;
+    }
+    // bytes saved by reusing memory compared with one block per allocation
+    size_t bytesSaved() const { return requested - peak; }
+
+    string toString() const;
+};
+
 class Allocator
 {
 private:
     Runtime runtime;
 
+    // bytes currently allocated
     size_t used;
+    // highest number of bytes allocated at the same time
+    size_t maxUsed;
+    // number of alloc() calls and the sum of their (aligned) sizes
+    size_t numAllocs;
+    size_t requested;
+    // end of the highest block handed out so far
+    size_t top;
+    // size of the memory to allocate, i.e. the highest top ever reached
     size_t peak;
     size_t alignment;
 
     // pointer to the memory actually allocated
     void *ptr;
+    // size of the memory pointed to by `ptr`
+    size_t capacity;
+    // alloc() and free() are only allowed before getPtr(), or after reset()
+    bool planning;
 
     // free block list:
     // key   : start offset
@@ -38,12 +84,22 @@ public:
     // simulate free
     void free(size_t addr, size_t size);
 
-    // do real allocation
+    // do real allocation, reusing the current memory if the plan fits in it
     void *getPtr();
 
-    void info();
+    // do real allocation for a plan of `size` bytes made earlier, dropping
+    // the current plan
+    void *getPtr(size_t size);
 
-private:
-    size_t getAlignedSize(size_t size);
+    // discard the plan to plan again, e.g. after a shape change. The memory
+    // is kept, so pointers from getPtr() stay valid until the next getPtr().
+    void reset();
+
+    size_t getAlignedSize(size_t size) const;
+
+    AllocatorStats getStats() const;
+
+    // print the statistics to stdout
+    void info() const;
 };
 }
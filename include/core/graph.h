@@ -1,62 +1,336 @@
 #pragma once
 #include "core/allocator.h"
+#include "core/memory_plan.h"
 #include "core/operator.h"
+#include "core/plan_cache.h"
+#include "core/spill_file.h"
 #include "core/tensor.h"
+#include "core/weight_store.h"
 #include <algorithm>
 #include <cstdint>
+#include <unordered_set>
 
 namespace infini
 {
 
+    /**
+     * @brief Peak live activation bytes before and after reordering.
+     */
+    struct ScheduleReport
+    {
+        size_t peakBefore;
+        size_t peakAfter;
+    };
+
+    /**
+     * @brief Steps during which an activation tensor occupies the arena. A
+     * spilled tensor leaves the arena after step `spillAfter` and comes back
+     * before step `reloadAt`, taking a separate block each time.
+     *
+     * Tensors that dataMalloc() places inside the block of another one, such
+     * as the output of a reshape, have no lifetime of their own: they are
+     * listed in `aliases` of the owner with their byte offset in its block,
+     * and their steps are merged into the owner's.
+     */
+    struct Lifetime
+    {
+        Tensor tensor;
+        int start, end;
+        // steps that write or read the tensor, in order
+        vector<int> accesses;
+        int spillAfter = -1, reloadAt = -1;
+        size_t offset = 0, reloadOffset = 0;
+        vector<std::pair<Tensor, size_t>> aliases;
+
+        bool spilled() const { return reloadAt >= 0; }
+        bool liveAt(int step) const
+        {
+            return start <= step && step <= end &&
+                   !(spilled() && spillAfter < step && step < reloadAt);
+        }
+    };
+
     class GraphObj : public Object
     {
     protected:
         Runtime runtime;
-        TensorVec tensors;
-        OpVec ops;
+        // Removal leaves a nullptr tombstone in the slot of the removed tensor
+        // or operator, which compact() squeezes out before anything iterates
+        // over them.
+        mutable TensorVec tensors;
+        mutable OpVec ops;
+        // slot of every tensor by guid and by fuid, and of every operator by
+        // guid
+        mutable std::unordered_map<UidBaseType, size_t> tensorSlots, fuidSlots,
+            opSlots;
+        mutable size_t tombstones;
         Allocator allocator;
+        MemoryPlan memoryPlan;
+        PlanCache planCache;
+        // 0 means no budget
+        size_t memoryBudget;
+        Ref<SpillFile> spillFile;
+        WeightStore weightStore;
+        // number of weight slots of `weightStore` already bound to tensors
+        size_t boundWeights;
+        // set by setOutputs(), empty if the outputs were never declared
+        TensorVec declaredOutputs;
 
     public:
         explicit GraphObj(Runtime runtime)
-            : runtime(runtime), allocator(runtime), sorted(false){};
+            : runtime(runtime), tombstones(0), allocator(runtime),
+              memoryBudget(0),
+              weightStore(make_ref<WeightStoreObj>(runtime)), boundWeights(0),
+              sorted(false){};
         string toString() const override;
         Runtime getRuntime() const { return runtime; }
 
         Tensor addTensor(Shape dim, DataType dtype = DataType::Float32);
         Tensor addTensor(const Tensor &tensor);
         TensorVec addTensor(const TensorVec &tensors);
-        void removeOperator(Operator op)
+        void removeOperator(Operator op);
+        void removeTensor(Tensor tensor);
+
+        const TensorVec &getTensors() const
         {
-            auto it = std::find(ops.begin(), ops.end(), op);
-            if (it != ops.end())
-                ops.erase(it);
+            compact();
+            return tensors;
         }
-
-        void removeTensor(Tensor tensor)
+        const OpVec &getOperators() const
         {
-            auto it = std::find(tensors.begin(), tensors.end(), tensor);
-            if (it != tensors.end())
-                tensors.erase(it);
+            compact();
+            return ops;
         }
-
-        const TensorVec &getTensors() const { return tensors; }
-        const OpVec &getOperators() const { return ops; }
         Tensor getTensor(int) const;
+        bool hasTensor(const Tensor &tensor) const;
+        bool hasOperator(const Operator &op) const;
 
         /**
          * @brief Sort the nodes in topological order.
          * It returns true if the sorting is successful.
          * Otherwise false is returned, means that there are rings in the graph,
-         * so the topological sorting fails.
+         * so the topological sorting fails. The operators on the rings are
+         * then available from getCycleOperators().
          */
         bool topo_sort();
 
+        const OpVec &getCycleOperators() const { return cycleOps; }
+        string cycleReport() const;
+
+        /**
+         * @brief Reorder the operators into the topological order with the
+         * lowest peak of live activation bytes found. Ready operators are
+         * picked greedily by bytes freed minus bytes allocated; graphs with at
+         * most `maxBeamOps` operators are also searched with a beam of
+         * `beamWidth` partial orders if `beamWidth` is not 0. The order is
+         * only changed if it lowers the peak, which drops the memory plan:
+         * call dataMalloc() or setInputShapes() again before running.
+         */
+        ScheduleReport memory_aware_sort(size_t beamWidth = 0,
+                                         size_t maxBeamOps = 64);
+
+        /**
+         * @brief Peak live activation bytes of the operator order topo_sort()
+         * would give, as dataMalloc() would plan it without fragmentation.
+         * The operators are left in place. Operators on a cycle are skipped.
+         */
+        size_t estimatePeak() const;
+
+        /**
+         * @brief Apply the graph rewrite rules until none of them matches.
+         */
         void optimize();
 
-        void shape_infer();
+        /**
+         * @brief Evaluate every operator whose inputs are all constants with
+         * data, and replace it with constant outputs in the weight store.
+         * Operators producing graph outputs or without a CPU kernel are kept.
+         * Call it after weightMalloc() and filling the constants; returns
+         * the number of operators folded. The slots of constants no longer
+         * read are reclaimed, see compactWeights().
+         */
+        size_t fold_constants();
+
+        /**
+         * @brief Merge operators with the same type and attributes (see
+         * OperatorObj::getOpAttrVector()) on the same inputs, moving the
+         * readers of the duplicates to the first one. Returns the number of
+         * operators removed.
+         */
+        size_t eliminate_common_subexpressions();
+
+        /**
+         * @brief Remove every operator and tensor that is not on a path to a
+         * graph output, reclaiming the slots of removed weights. Returns the
+         * number of operators removed.
+         */
+        size_t eliminate_dead_code();
+
+        /**
+         * @brief Collapse chains of element-wise operators (Add, Sub, Mul,
+         * Div, Relu and Clip) into FusedElementWiseObj operators evaluated
+         * in one pass. Returns the number of operators fused away.
+         */
+        size_t fuse_element_wise();
+
+        /**
+         * @brief Merge matmuls that read the same A with constant weights of
+         * the same shape into one matmul over the stacked weights, see
+         * FuseSiblingMatmulsRule. Returns the number of merges.
+         */
+        size_t fuse_sibling_matmuls();
+
+        /**
+         * @brief Repack the constant B of matmuls into column panels once,
+         * see PrepackMatmulWeightsRule, and fold the packing into the
+         * weight store, whose slots of the unpacked weights are reclaimed.
+         * Same requirements as fold_constants(); returns the number of
+         * weights repacked.
+         */
+        size_t prepack_weights();
+
+        /**
+         * @brief Whether each operator of getOperators() is on a path to one
+         * of `outputs`.
+         */
+        vector<bool> opsNeededFor(const TensorVec &outputs) const;
+
+        /**
+         * @brief Make `op` read `to` instead of `from`, keeping the
+         * targets, predecessors and successors in sync. `from` is removed
+         * from the graph once nothing is connected to it.
+         */
+        void replaceInput(const Operator &op, const Tensor &from,
+                          const Tensor &to);
+
+        /**
+         * @brief Make every reader of `from` read `to` instead.
+         */
+        void replaceAllUses(const Tensor &from, const Tensor &to);
+
+        /**
+         * @brief Add an operator built without a graph, e.g. by clone(), on
+         * tensors of this graph.
+         */
+        void addOperator(const Operator &op)
+        {
+            IT_ASSERT(!hasOperator(op));
+            addOperatorAndConnect(op);
+        }
+
+        /**
+         * @brief Put `replacement`, which must have been built without a
+         * graph on the same outputs as `op`, in the place of `op`.
+         */
+        void replaceOperator(const Operator &op, const Operator &replacement);
+        /**
+         * @brief Put `replacement` in the place of all of `replaced`, whose
+         * outputs, in order, must be the outputs of `replacement`.
+         */
+        void replaceOperators(const OpVec &replaced,
+                              const Operator &replacement);
+
+        /**
+         * @brief Disconnect `op` and remove it with its outputs, which must
+         * have no readers left. Inputs left without a producer or a reader
+         * are removed too.
+         */
+        void eraseOperator(const Operator &op);
 
+        /**
+         * @brief Infer the output shapes of every operator again, in
+         * topological order. Returns the tensors whose shape changed.
+         */
+        TensorVec shape_infer();
+        /**
+         * @brief Infer shapes after the tensors in `changed` were given new
+         * shapes: only operators downstream of them are inferred again, and
+         * propagation stops at outputs whose shape stays the same. Returns
+         * the tensors whose shape changed, `changed` excluded.
+         */
+        TensorVec shape_infer(const TensorVec &changed);
+
+        /**
+         * @brief Bind every weight tensor to the weight store, then plan the
+         * activation arena over the remaining tensors and bind them to it.
+         * Calling it again re-plans with the current shapes and rebinds the
+         * tensors, reusing the arena if the new plan fits in it.
+         */
         void dataMalloc();
 
+        /**
+         * @brief Bind weight tensors that have no data yet to slots of the
+         * weight store, in tensor order, reserving new slots when the store
+         * runs out. Called by dataMalloc(); call it earlier to fill weights
+         * before the activation arena is planned.
+         */
+        void weightMalloc();
+
+        /**
+         * @brief Gets the activation memory plan of the last dataMalloc().
+         */
+        const MemoryPlan &getMemoryPlan() const { return memoryPlan; }
+
+        /**
+         * @brief Keep the activation arena within `bytes` (0 for no limit).
+         * When the plan does not fit, dataMalloc() spills tensors to a file
+         * in `spillDir` while they are idle and reloads them before their
+         * next reader, and fails if that is not enough.
+         */
+        void setMemoryBudget(size_t bytes, const string &spillDir = "/tmp");
+        const Ref<SpillFile> &getSpillFile() const { return spillFile; }
+
+        /**
+         * @brief Called by runtimes before and after running the operator at
+         * `step` of getOperators(), to move spilled tensors.
+         */
+        void prepareOp(size_t step);
+        void finishOp(size_t step);
+
+        /**
+         * @brief Set the shapes of the graph inputs that are not weights, in
+         * getInputs() order, then infer the other shapes and plan memory. The
+         * result is cached per input shapes, so a shape seen before skips
+         * shape_infer() and dataMalloc() and only rebinds the arena.
+         *
+         * With buckets set on the cache, shapes are rounded up to their
+         * bucket first and the graph runs with the bucket shapes: the caller
+         * must pad the inputs accordingly. Inputs bound with bindInput() are
+         * not rounded, and a bound tensor that outgrows its buffer fails.
+         */
+        void setInputShapes(const vector<Shape> &shapes);
+        PlanCache &getPlanCache() { return planCache; }
+
+        /**
+         * @brief Use `store` for the weights of this graph. Passing the store
+         * of another instance of the same model shares its weights instead of
+         * loading them again. Must be called before weightMalloc(), and
+         * before the other instance folds its constants: a store is compacted
+         * only while no other graph holds it.
+         */
+        void setWeightStore(WeightStore store)
+        {
+            IT_ASSERT(boundWeights == 0, "Weights are already bound");
+            weightStore = std::move(store);
+        }
+        WeightStore getWeightStore() const { return weightStore; }
+
+        /**
+         * @brief Let the runtime read a graph input directly from a
+         * caller-owned buffer of `bytes` bytes. Bound tensors are left out of
+         * the activation arena if bound before dataMalloc(); binding again
+         * later (e.g. per request) only swaps the pointer. Growing the tensor
+         * past `bytes` later, e.g. with setInputShapes(), fails until a
+         * larger buffer is bound.
+         */
+        void bindInput(const Tensor &tensor, void *ptr, size_t bytes);
+
+        /**
+         * @brief Let the runtime write a graph output directly to a
+         * caller-owned buffer of `bytes` bytes. See bindInput().
+         */
+        void bindOutput(const Tensor &tensor, void *ptr, size_t bytes);
+
         /**
          * @brief Add an operator and create its outputs. Output tensor arguments
          * should be empty Refs (e.g., nullptr).
@@ -85,6 +359,7 @@ namespace infini
          */
         inline TensorVec getInputs() const
         {
+            compact();
             TensorVec ret;
             for (const auto &t : tensors)
                 if (!t->getSource())
@@ -93,10 +368,14 @@ namespace infini
         }
 
         /**
-         * @brief Gets output tensors of this graph.
+         * @brief Gets output tensors of this graph: the ones declared by
+         * setOutputs(), or every tensor without readers if none were.
          */
         inline TensorVec getOutputs() const
         {
+            if (!declaredOutputs.empty())
+                return declaredOutputs;
+            compact();
             TensorVec ret;
             for (const auto &t : tensors)
                 if (t->getTargets().empty())
@@ -104,9 +383,51 @@ namespace infini
             return ret;
         }
 
+        /**
+         * @brief Declare the tensors the caller reads after run(). Tensors
+         * without readers are then no longer outputs by themselves, and
+         * eliminate_dead_code() removes what the outputs do not need.
+         */
+        void setOutputs(const TensorVec &outputs);
+        bool isOutput(const Tensor &tensor) const;
+        /**
+         * @brief Whether setInputShapes() can change the shape of `tensor`,
+         * i.e. it is computed from a graph input that is not a weight.
+         */
+        bool isResizable(const Tensor &tensor) const;
+        // no reader and not a graph output, so its producer can go
+        bool isUnused(const Tensor &tensor) const
+        {
+            return tensor->getTargets().empty() &&
+                   std::find(declaredOutputs.begin(), declaredOutputs.end(),
+                             tensor) == declaredOutputs.end();
+        }
+
         bool checkValid() const;
 
     private:
+        // drop tombstones and renumber the slots
+        void compact() const;
+        // rebuild the slot indices after `tensors` or `ops` was reassigned
+        void reindex() const;
+        // Move the weights still in the graph to a new store without the
+        // slots of removed ones. Skipped while the store is shared or mapped
+        // from a file, whose slots must keep their numbering.
+        void compactWeights();
+
+        void planArena(vector<Lifetime> &lifetimes, int numOps);
+        // infer `dirty` and the readers of every output whose shape changes
+        TensorVec inferShapesOf(std::unordered_set<OperatorObj *> dirty);
+
+        void bindExternal(const Tensor &tensor, void *ptr, size_t bytes);
+
+        // fail if a tensor outgrew the buffer it was bound to
+        void checkExternalBytes() const;
+
+        // drop the cached plans and unbind the arena tensors, whose offsets
+        // no longer fit the operator order
+        void invalidatePlan();
+
         /**
          * @brief Add reverse connections and Op relationship in ctor.
          */
@@ -116,6 +437,13 @@ namespace infini
          * @brief If the nodes is sorted in topological order.
          */
         bool sorted;
+
+        // operators on a cycle found by the last failed topo_sort()
+        OpVec cycleOps;
+
+        // isResizable() of the tensors queried so far, by guid; cleared when
+        // an operator is added, removed or rewired
+        mutable std::unordered_map<UidBaseType, bool> resizable;
     };
 
 } // namespace infini
@@ -59,6 +59,10 @@ namespace infini
                                                "}");
             return std::get<0>(it->second);
         }
+        bool hasKernel(const KernelAttrs &kernelAttrs) const
+        {
+            return kernels.find(kernelAttrs) != kernels.end();
+        }
         const KernelRecord &getKernelItem(const KernelAttrs &kernelAttrs) const
         {
             return kernels.at(kernelAttrs);
@@ -0,0 +1,43 @@
+#pragma once
+#include "core/allocator.h"
+#include "core/object.h"
+
+namespace infini
+{
+/**
+ * @brief Placement of one tensor in the activation arena.
+ */
+struct MemoryPlanEntry
+{
+    UidBaseType guid;
+    UidBaseType fuid;
+    size_t offset;
+    size_t bytes;
+    // The tensor is live from operator `allocStep` through `freeStep`,
+    // counted in the sorted operator list. Graph inputs are allocated at -1,
+    // tensors that are never freed have `freeStep` equal to the op count.
+    int allocStep;
+    int freeStep;
+};
+
+/**
+ * @brief Memory plan produced by GraphObj::dataMalloc(), for tracking memory
+ * use across model versions.
+ */
+struct MemoryPlan
+{
+    vector<MemoryPlanEntry> entries;
+    AllocatorStats stats;
+    // bytes of the weight store, which is not part of the arena
+    size_t weightBytes = 0;
+
+    string toJson() const;
+    string toCsv() const;
+
+    /**
+     * @brief Write the plan to `path`, as CSV if it ends with ".csv" and as
+     * JSON otherwise.
+     */
+    void dump(const string &path) const;
+};
+} // namespace infini
@@ -24,6 +24,10 @@ namespace infini
             Relu,
             Sub,
             Transpose,
+            // values above are fixed, new types are appended
+            Reshape,
+            FusedElementWise,
+            Split,
 
         } type;
 
@@ -55,6 +55,22 @@ namespace infini
         virtual int numInputs() const = 0;
         virtual int numOutputs() const = 0;
 
+        /**
+         * @brief The operator type followed by the attributes. Operators with
+         * equal vectors compute the same outputs from the same inputs.
+         */
+        virtual vector<int> getOpAttrVector() const
+        {
+            return {type.underlying()};
+        }
+        /**
+         * @brief Append `value` to an attribute vector as a presence flag
+         * and its bit pattern, 0 when missing, so that operators encode
+         * optional bounds alike.
+         */
+        static void appendOptionalFloat(vector<int> &attrs,
+                                        optional<float> value);
+
         /**
          * @brief Clone this operator and replace its inputs and outputs.
          *
@@ -0,0 +1,84 @@
+#pragma once
+#include "core/graph.h"
+
+namespace infini
+{
+/**
+ * @brief What one pass did to the graph in the last PassManager::run().
+ */
+struct PassStats
+{
+    string name;
+    // wall time in milliseconds
+    double time;
+    size_t opsBefore, opsAfter;
+    size_t tensorsBefore, tensorsAfter;
+    // peak live activation bytes of the operator order, see
+    // GraphObj::estimatePeak()
+    size_t peakBefore, peakAfter;
+
+    long long opsRemoved() const { return (long long)opsBefore - opsAfter; }
+    long long tensorsRemoved() const
+    {
+        return (long long)tensorsBefore - tensorsAfter;
+    }
+    long long bytesSaved() const { return (long long)peakBefore - peakAfter; }
+    string toString() const;
+};
+
+/**
+ * @brief Ordered list of named graph passes that can be switched off or
+ * reordered, and that records PassStats for every pass it runs.
+ */
+class PassManager
+{
+public:
+    using PassFunc = std::function<void(GraphObj &)>;
+
+private:
+    struct Pass
+    {
+        string name;
+        PassFunc func;
+        bool enabled;
+    };
+    vector<Pass> passes;
+    vector<PassStats> stats;
+
+    // index of the pass called `name`
+    size_t indexOf(const string &name) const;
+
+public:
+    /**
+     * @brief The usual compile pipeline: optimize, dce, cse,
+     * fuse_sibling_matmuls, fold_constants, prepack_weights,
+     * fuse_element_wise, shape_infer, topo_sort, memory_aware_sort (disabled)
+     * and data_malloc.
+     */
+    static PassManager standard();
+
+    // append a pass, names must be unique
+    void addPass(const string &name, PassFunc func, bool enabled = true);
+
+    void enable(const string &name) { passes[indexOf(name)].enabled = true; }
+    void disable(const string &name) { passes[indexOf(name)].enabled = false; }
+    bool isEnabled(const string &name) const
+    {
+        return passes[indexOf(name)].enabled;
+    }
+
+    /**
+     * @brief Run the passes in the order of `names`, which must list every
+     * pass once.
+     */
+    void setOrder(const vector<string> &names);
+    vector<string> getOrder() const;
+
+    // run the enabled passes in order on `graph`
+    void run(GraphObj &graph);
+
+    const vector<PassStats> &getStats() const { return stats; }
+    // one line per pass of the last run(), and the total time
+    string report() const;
+};
+} // namespace infini
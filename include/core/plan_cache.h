@@ -0,0 +1,89 @@
+#pragma once
+#include "core/memory_plan.h"
+#include "core/tensor.h"
+
+namespace infini
+{
+/**
+ * @brief Compiled state of a graph for one tuple of input shapes, keyed by
+ * the (optionally bucketed) input shapes. See GraphObj::setInputShapes().
+ * At most `capacity` plans are kept; the least recently used one is evicted
+ * to make room for a new one.
+ */
+class PlanCache
+{
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    struct Plan
+    {
+        // shape of every graph tensor, in graph order
+        vector<Shape> shapes;
+        // strides of the tensors placed as views, empty for the others
+        vector<vector<size_t>> strides;
+        // arena offset of every graph tensor, npos if it is not in the arena
+        vector<size_t> offsets;
+        MemoryPlan memoryPlan;
+    };
+
+private:
+    struct Entry
+    {
+        Plan plan;
+        // value of `clock` when the plan was last inserted or found
+        size_t lastUse;
+    };
+
+    std::map<vector<Shape>, Entry> plans;
+    // axis -> ascending bucket bounds
+    std::map<int, vector<ShapeElem>> buckets;
+    // 0 means no limit
+    size_t capacity;
+    size_t clock;
+    size_t hits;
+    size_t misses;
+    size_t evictions;
+
+    // drop the least recently used plans until at most `limit` are left
+    void evict(size_t limit);
+
+public:
+    static constexpr size_t defaultCapacity = 64;
+
+    PlanCache()
+        : capacity(defaultCapacity), clock(0), hits(0), misses(0),
+          evictions(0) {}
+
+    /**
+     * @brief Keep at most `n` plans (0 for no limit), evicting the least
+     * recently used ones beyond it.
+     */
+    void setCapacity(size_t n);
+    size_t getCapacity() const { return capacity; }
+
+    /**
+     * @brief Round dimension `axis` of every input up to the smallest of
+     * `bounds` that holds it, so that nearby shapes share a plan. Dimensions
+     * larger than every bound are kept as they are.
+     */
+    void setBuckets(int axis, vector<ShapeElem> bounds);
+
+    // input shapes rounded up to their buckets
+    vector<Shape> getKey(const vector<Shape> &inputShapes) const;
+
+    // the plan for `key`, nullptr on a miss; counts hits and misses. The
+    // pointer is valid until the next insert().
+    const Plan *find(const vector<Shape> &key);
+
+    void insert(vector<Shape> key, Plan plan);
+
+    // drop all plans, e.g. after the graph changed; counters are kept and
+    // the dropped plans are not counted as evictions
+    void clear() { plans.clear(); }
+
+    size_t size() const { return plans.size(); }
+    size_t getHits() const { return hits; }
+    size_t getMisses() const { return misses; }
+    size_t getEvictions() const { return evictions; }
+};
+} // namespace infini
@@ -0,0 +1,78 @@
+#pragma once
+#include "core/graph.h"
+
+namespace infini
+{
+/**
+ * @brief Pattern over an operator and, recursively, the producers of its
+ * inputs.
+ */
+struct Pattern
+{
+    OpType type;
+    // extra condition on the operator, e.g. on its attributes
+    std::function<bool(const Operator &)> predicate;
+    // patterns of the producers of the inputs, nullptr matches any tensor
+    vector<Ref<Pattern>> inputs;
+    // the output of the operator is read by the matched consumer only
+    bool singleUse = false;
+};
+
+Ref<Pattern> pattern(OpType type, vector<Ref<Pattern>> inputs = {},
+                     std::function<bool(const Operator &)> predicate = nullptr,
+                     bool singleUse = false);
+
+/**
+ * @brief Operators matched by a pattern, in pre-order: `ops[0]` is the root,
+ * followed by the matches of its input patterns from left to right.
+ */
+struct Match
+{
+    OpVec ops;
+};
+
+/**
+ * @brief One graph rewrite. The rewriter calls apply() on every match of
+ * getPattern(); apply() edits the graph through the rewiring utilities of
+ * GraphObj and returns whether it changed anything.
+ */
+class RewriteRule
+{
+public:
+    virtual ~RewriteRule() = default;
+    virtual string getName() const = 0;
+    virtual const Pattern &getPattern() const = 0;
+    virtual bool apply(GraphObj &graph, const Match &match) = 0;
+};
+
+/**
+ * @brief Applies a list of rules to a graph until none of them matches.
+ *
+ * Every operator is visited once from a worklist. When a rule fires, the
+ * neighbours of the rewritten operators are visited again, so rewrites that
+ * enable each other still reach the fixpoint.
+ */
+class GraphRewriter
+{
+private:
+    vector<Ref<RewriteRule>> rules;
+    // rule name -> number of rewrites in the last run()
+    std::map<string, size_t> counts;
+
+public:
+    void addRule(Ref<RewriteRule> rule) { rules.emplace_back(std::move(rule)); }
+
+    template <typename T, typename... Args>
+    void addRule(Args &&...args)
+    {
+        addRule(make_ref<T>(std::forward<Args>(args)...));
+    }
+
+    static bool match(const Pattern &pattern, const Operator &op, Match &match);
+
+    // returns the number of rewrites done
+    size_t run(GraphObj &graph);
+
+    const std::map<string, size_t> &getCounts() const { return counts; }
+};
+} // namespace infini
@@ -0,0 +1,256 @@
+#pragma once
+#include "core/rewrite.h"
+
+namespace infini
+{
+/**
+ * @brief Transpose(Transpose(x)) becomes a single transpose of x with the
+ * composed permutation, or x itself if the permutations cancel out.
+ */
+class ComposeTransposeRule : public RewriteRule
+{
+private:
+    Ref<Pattern> root;
+
+public:
+    ComposeTransposeRule();
+    string getName() const override { return "ComposeTranspose"; }
+    const Pattern &getPattern() const override { return *root; }
+    bool apply(GraphObj &graph, const Match &match) override;
+};
+
+/**
+ * @brief A transpose that keeps the order of the dimensions larger than 1
+ * does not move any data: it is removed if it is the identity, and becomes
+ * a reshape otherwise. The rewrite is only valid for the current shapes.
+ */
+class TransposeToReshapeRule : public RewriteRule
+{
+private:
+    Ref<Pattern> root;
+
+public:
+    TransposeToReshapeRule();
+    string getName() const override { return "TransposeToReshape"; }
+    const Pattern &getPattern() const override { return *root; }
+    bool apply(GraphObj &graph, const Match &match) override;
+};
+
+/**
+ * @brief A transpose feeding matmul input `input` (0 for A, 1 for B) is
+ * folded into the permutation the matmul reads that input through, or into
+ * transA/transB if it only swaps the last two dimensions.
+ */
+class FoldTransposeIntoMatmulRule : public RewriteRule
+{
+private:
+    int input;
+    Ref<Pattern> root;
+
+public:
+    explicit FoldTransposeIntoMatmulRule(int input);
+    string getName() const override { return "FoldTransposeIntoMatmul"; }
+    const Pattern &getPattern() const override { return *root; }
+    bool apply(GraphObj &graph, const Match &match) override;
+};
+
+/**
+ * @brief A transpose read only by a unary operator (Relu, Clip or Cast) of
+ * type `type` is moved after it, when the one reader of the operator then
+ * absorbs the transpose: another transpose, a matmul that folds it, or an
+ * operator it can be sunk through in turn.
+ */
+class SinkTransposeThroughUnaryRule : public RewriteRule
+{
+private:
+    Ref<Pattern> root;
+
+public:
+    explicit SinkTransposeThroughUnaryRule(OpType type);
+    string getName() const override { return "SinkTransposeThroughUnary"; }
+    const Pattern &getPattern() const override { return *root; }
+    bool apply(GraphObj &graph, const Match &match) override;
+};
+
+/**
+ * @brief A binary element-wise operator of type `type` whose inputs are
+ * transposed the same way runs on the untransposed inputs instead, followed
+ * by a single transpose. An input without such a transpose takes part if
+ * undoing the permutation on it is a reshape. The rewrite is done when it
+ * merges transposes or the reader absorbs the transpose.
+ */
+class SinkTransposeThroughElementWiseRule : public RewriteRule
+{
+private:
+    Ref<Pattern> root;
+
+public:
+    explicit SinkTransposeThroughElementWiseRule(OpType type);
+    string getName() const override
+    {
+        return "SinkTransposeThroughElementWise";
+    }
+    const Pattern &getPattern() const override { return *root; }
+    bool apply(GraphObj &graph, const Match &match) override;
+};
+
+/**
+ * @brief The same as SinkTransposeThroughElementWiseRule for Concat, which
+ * then concatenates along the permuted axis.
+ */
+class SinkTransposeThroughConcatRule : public RewriteRule
+{
+private:
+    Ref<Pattern> root;
+
+public:
+    SinkTransposeThroughConcatRule();
+    string getName() const override { return "SinkTransposeThroughConcat"; }
+    const Pattern &getPattern() const override { return *root; }
+    bool apply(GraphObj &graph, const Match &match) override;
+};
+
+/**
+ * @brief An Add of a bias of N elements to the result of a matmul, which is
+ * read by nothing else, becomes the bias of the matmul.
+ */
+class FuseBiasIntoMatmulRule : public RewriteRule
+{
+private:
+    Ref<Pattern> root;
+
+public:
+    FuseBiasIntoMatmulRule();
+    string getName() const override { return "FuseBiasIntoMatmul"; }
+    const Pattern &getPattern() const override { return *root; }
+    bool apply(GraphObj &graph, const Match &match) override;
+};
+
+/**
+ * @brief A Relu or Clip (`type`) on the result of a matmul, which is read by
+ * nothing else, becomes the activation of the matmul.
+ */
+class FuseActivationIntoMatmulRule : public RewriteRule
+{
+private:
+    Ref<Pattern> root;
+
+public:
+    explicit FuseActivationIntoMatmulRule(OpType type);
+    string getName() const override { return "FuseActivationIntoMatmul"; }
+    const Pattern &getPattern() const override { return *root; }
+    bool apply(GraphObj &graph, const Match &match) override;
+};
+
+/**
+ * @brief Relu and Clip (`outer`) applied to the result of a Relu or Clip
+ * (`inner`) that has no other reader become one Clip with the tighter
+ * bounds, or one Relu if that is what the bounds amount to.
+ */
+class MergeClampsRule : public RewriteRule
+{
+private:
+    Ref<Pattern> root;
+
+public:
+    MergeClampsRule(OpType outer, OpType inner);
+    string getName() const override { return "MergeClamps"; }
+    const Pattern &getPattern() const override { return *root; }
+    bool apply(GraphObj &graph, const Match &match) override;
+};
+
+/**
+ * @brief Remove an operator of type `type` that returns its input: a Clip
+ * without bounds, a Cast to the same data type, Mul or Div by a constant
+ * one, and Add or Sub of a constant zero, as long as the other operand does
+ * not broadcast the input to a larger shape, also after setInputShapes().
+ */
+class RemoveIdentityRule : public RewriteRule
+{
+private:
+    Ref<Pattern> root;
+
+public:
+    explicit RemoveIdentityRule(OpType type);
+    string getName() const override { return "RemoveIdentity"; }
+    const Pattern &getPattern() const override { return *root; }
+    bool apply(GraphObj &graph, const Match &match) override;
+};
+
+/**
+ * @brief A Cast back to the original data type after a lossless widening
+ * Cast, e.g. Int32 to Int64 and back, returns the original tensor.
+ */
+class RemoveCastRoundTripRule : public RewriteRule
+{
+private:
+    Ref<Pattern> root;
+
+public:
+    RemoveCastRoundTripRule();
+    string getName() const override { return "RemoveCastRoundTrip"; }
+    const Pattern &getPattern() const override { return *root; }
+    bool apply(GraphObj &graph, const Match &match) override;
+};
+
+/**
+ * @brief Matmuls reading the same A with constant B of the same shape run as
+ * one matmul over B stacked along n. The stacking is a Concat, which
+ * fold_constants() evaluates once, and a Split along the last axis writes
+ * the original outputs, so the rewrite holds for any batch of A.
+ * Matmuls with a bias, or whose B is not loaded yet and so could not be
+ * stacked once, are not merged.
+ */
+class FuseSiblingMatmulsRule : public RewriteRule
+{
+private:
+    Ref<Pattern> root;
+
+public:
+    FuseSiblingMatmulsRule();
+    string getName() const override { return "FuseSiblingMatmuls"; }
+    const Pattern &getPattern() const override { return *root; }
+    bool apply(GraphObj &graph, const Match &match) override;
+};
+
+/**
+ * @brief An element-wise operator of type `type` (see
+ * FusedElementWiseObj::canFuse(), or FusedElementWise itself) takes in an
+ * element-wise producer of one of its inputs that has no other reader and
+ * the same output shape, making a FusedElementWiseObj. Applied until no rule
+ * matches, it collapses maximal chains.
+ */
+class FuseElementWiseRule : public RewriteRule
+{
+private:
+    Ref<Pattern> root;
+
+public:
+    explicit FuseElementWiseRule(OpType type);
+    string getName() const override { return "FuseElementWise"; }
+    const Pattern &getPattern() const override { return *root; }
+    bool apply(GraphObj &graph, const Match &match) override;
+};
+
+/**
+ * @brief A matmul with a constant B reads it prepacked in panels of
+ * `panel` columns (see MatmulObj::getPanelB()), so the kernel streams each
+ * panel contiguously. The packing, with transB and permB folded in, is a
+ * Reshape and Transposes that fold_constants() evaluates once, shared by
+ * the matmuls reading the same weight the same way. Matmuls whose n is not a
+ * multiple of `panel`, or whose B is not loaded yet and so could not be
+ * folded, are left as they are.
+ */
+class PrepackMatmulWeightsRule : public RewriteRule
+{
+private:
+    Ref<Pattern> root;
+    int panel;
+
+public:
+    explicit PrepackMatmulWeightsRule(int panel);
+    string getName() const override { return "PrepackMatmulWeights"; }
+    const Pattern &getPattern() const override { return *root; }
+    bool apply(GraphObj &graph, const Match &match) override;
+};
+} // namespace infini
@@ -37,10 +37,17 @@ namespace infini
     RuntimeObj &operator=(RuntimeObj const &) = delete;
     virtual ~RuntimeObj() {}
 
-    virtual void run(const Graph &graph) const = 0;
+    /**
+     * @brief Run the operators of `graph` in order. If `outputs` is not
+     * empty, only the operators they depend on are computed.
+     */
+    virtual void run(const Graph &graph,
+                     const TensorVec &outputs = {}) const = 0;
     virtual void *alloc(size_t size) = 0;
     virtual void dealloc(void *ptr) = 0;
 
+    Device getDevice() const { return device; }
+
     bool isCpu() const
     {
       return true;
@@ -61,7 +68,7 @@ namespace infini
       return instance;
     }
     void dealloc(void *ptr) override;
-    void run(const Graph &graph) const override;
+    void run(const Graph &graph, const TensorVec &outputs = {}) const override;
     void *alloc(size_t size) override;
     string toString() const override;
   };
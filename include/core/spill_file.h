@@ -0,0 +1,64 @@
+#pragma once
+#include "core/tensor.h"
+
+namespace infini
+{
+/**
+ * @brief Memory-mapped file holding activations evicted from the arena.
+ *
+ * When a graph runs under a memory budget, GraphObj::dataMalloc() may take a
+ * tensor out of the arena while nothing reads it: the tensor is copied to
+ * the file after step `spillAfter` and copied back to another arena block
+ * before step `reloadAt`. The runtime drives the copies through
+ * GraphObj::prepareOp() and GraphObj::finishOp().
+ */
+class SpillFile
+{
+private:
+    struct Spill
+    {
+        Tensor tensor;
+        void *home;
+        void *reload;
+        size_t offset;
+        size_t bytes;
+    };
+
+    string dir;
+    int fd;
+    void *base;
+    size_t size;
+    vector<Spill> spills;
+    // step -> indices of `spills` to write after / read before that step
+    std::map<int, vector<size_t>> spillAfter, reloadAt;
+
+public:
+    explicit SpillFile(string dir = "/tmp");
+    SpillFile(SpillFile &other) = delete;
+    SpillFile &operator=(SpillFile const &) = delete;
+    ~SpillFile();
+
+    // forget all spills, the file is kept for the next plan
+    void reset();
+
+    /**
+     * @brief Move `tensor` from `home` to the file after step `spillAfter`
+     * and back to `reload` before step `reloadAt`.
+     */
+    void add(const Tensor &tensor, void *home, int spillAfter, void *reload,
+             int reloadAt);
+
+    // size the file for the spills added so far and map it
+    void mapFile();
+
+    bool empty() const { return spills.empty(); }
+    size_t getBytes() const { return size; }
+
+    // point every spilled tensor back at its first arena block
+    void rewind();
+    // reload the tensors read by `step`, and ask for the next ones early
+    void beforeStep(int step);
+    // write out the tensors that `step` is the last reader of for a while
+    void afterStep(int step);
+};
+} // namespace infini
@@ -24,6 +24,22 @@ namespace infini
         WRef<OperatorObj> source;
         Blob data;
         Runtime runtime;
+        // Weights live in the graph's WeightStore instead of the activation
+        // arena and keep their data across runs.
+        bool weight;
+        // A weight whose data is filled before the graph is compiled, so that
+        // GraphObj::fold_constants() can evaluate the operators reading it.
+        bool constant;
+        // Bound to a caller-owned buffer by GraphObj::bindInput/bindOutput and
+        // left out of the activation arena.
+        bool external;
+        // size of that buffer, checked again whenever the graph is replanned
+        size_t externalBytes;
+        // Element strides when the tensor is a view placed by
+        // GraphObj::dataMalloc() over the memory of another tensor, empty when
+        // it is contiguous row-major. The view's byte offset is already part
+        // of its blob pointer.
+        vector<size_t> strides;
 
     private:
         Shape shape;
@@ -42,12 +58,26 @@ namespace infini
         Shape getDims() const { return shape; }
         void setShape(Shape shape_);
         size_t getRank() const { return shape.size(); }
+        // The element strides, computed row-major ones for contiguous tensors
+        vector<size_t> getStrides() const;
+        bool isContiguous() const { return strides.empty(); }
         UidBaseType getFuid() const { return fuid; }
 
         void setData(
             std::function<void(void *, size_t, DataType)> const &generator) const;
 
         void setDataBlob(const Blob &blob);
+        bool hasData() const { return data != nullptr; }
+
+        void setWeight() { weight = true; }
+        bool isWeight() const { return weight; }
+        void setConstant()
+        {
+            weight = true;
+            constant = true;
+        }
+        bool isConstant() const { return constant; }
+        bool isExternal() const { return external; }
 
         void printData() const;
         bool equalData(const Tensor &rhs, double relativeError = 1e-6) const;
@@ -96,7 +126,7 @@ namespace infini
                     if (i % dimSzVec[j] == 0)
                         builder << "[";
 
-                builder << ptr[i];
+                builder << ptr[offsetOf(i)];
                 for (size_t j = 0; j < numDims; ++j)
                     if ((int)i % dimSzVec[j] == dimSzVec[j] - 1)
                         builder << "]";
@@ -113,29 +143,32 @@ namespace infini
 
         template <typename T>
         bool equalDataImpl(const T *a, const T *b, size_t size,
-                           double relativeError = 1e-6) const
+                           double relativeError = 1e-6,
+                           const TensorObj *rhs = nullptr) const
         {
             for (size_t i = 0; i < size; ++i)
             {
+                // `a` is the data of this tensor and `b` that of `rhs`, or a
+                // contiguous vector without it
+                auto x = a[offsetOf(i)], y = b[rhs ? rhs->offsetOf(i) : i];
                 if constexpr (std::is_integral_v<T>)
                 {
-                    if (a[i] != b[i])
+                    if (x != y)
                         return false;
                 }
                 else if constexpr (std::is_floating_point_v<T>)
                 {
-                    if (std::min(fabs(a[i]), fabs(b[i])) == 0. &&
-                        fabs(a[i] - b[i]) > relativeError)
+                    if (std::min(fabs(x), fabs(y)) == 0. &&
+                        fabs(x - y) > relativeError)
                     {
-                        printf("Error on %lu: %f %f\n", i, a[i], b[i]);
+                        printf("Error on %lu: %f %f\n", i, x, y);
                         return false;
                     }
-                    else if (std::min(fabs(a[i]), fabs(b[i])) != 0. &&
-                             fabs(a[i] - b[i]) /
-                                     std::max(fabs(a[i]), fabs(b[i])) >
+                    else if (std::min(fabs(x), fabs(y)) != 0. &&
+                             fabs(x - y) / std::max(fabs(x), fabs(y)) >
                                  relativeError)
                     {
-                        printf("Error on %lu: %f %f\n", i, a[i], b[i]);
+                        printf("Error on %lu: %f %f\n", i, x, y);
                         return false;
                     }
                 }
@@ -147,6 +180,21 @@ namespace infini
             return true;
         }
 
+        // contiguous row-major strides are stored as empty
+        void setStrides(vector<size_t> strides_);
+        // element offset of the row-major element `index` in the data
+        size_t offsetOf(size_t index) const
+        {
+            if (strides.empty())
+                return index;
+            size_t offset = 0;
+            for (size_t axis = shape.size(); axis > 0; --axis)
+            {
+                offset += index % shape[axis - 1] * strides[axis - 1];
+                index /= shape[axis - 1];
+            }
+            return offset;
+        }
         void addTarget(const Operator &op) { targets.emplace_back(op); }
         void setSource(const Operator &op) { source = op; }
         void removeTarget(const Operator &op)
@@ -0,0 +1,78 @@
+#pragma once
+#include "core/runtime.h"
+#include <cstddef>
+
+namespace infini
+{
+class WeightStoreObj;
+using WeightStore = Ref<WeightStoreObj>;
+
+/**
+ * @brief Long-lived storage for the weights of a graph.
+ *
+ * Weights are kept apart from the activation arena planned by Allocator: they
+ * are laid out once in contiguous regions and stay alive for the lifetime of
+ * the store. A store can be shared by several graphs built from the same
+ * model, and can be saved to a file and mapped back read-only with load().
+ *
+ * Each weight occupies a slot. Slots are numbered in the order they are
+ * reserved; GraphObj binds its weight tensors to slots in tensor order.
+ */
+class WeightStoreObj
+{
+private:
+    struct Region
+    {
+        void *ptr;
+        size_t size;
+        bool mapped;
+    };
+
+    struct Slot
+    {
+        size_t region;
+        size_t offset;
+        size_t bytes;
+    };
+
+    Runtime runtime;
+    size_t alignment;
+    vector<Region> regions;
+    vector<Slot> slots;
+
+public:
+    explicit WeightStoreObj(Runtime runtime);
+    WeightStoreObj(WeightStoreObj &other) = delete;
+    WeightStoreObj &operator=(WeightStoreObj const &) = delete;
+    ~WeightStoreObj();
+
+    // reserve a slot of `bytes`, backed by memory at the next materialize()
+    size_t reserve(size_t bytes);
+
+    // allocate one region for all slots reserved since the last call
+    void materialize();
+
+    void *getPtr(size_t slot) const;
+    size_t getSlotBytes(size_t slot) const { return slots.at(slot).bytes; }
+    size_t numSlots() const { return slots.size(); }
+    bool isReadOnly(size_t slot) const;
+
+    // total bytes held by all regions
+    size_t getBytes() const;
+
+    /**
+     * @brief Write every slot to `path`. The file can be mapped back with
+     * load() without copying the weights.
+     */
+    void save(const string &path) const;
+
+    /**
+     * @brief Map a file written by save() read-only into a new store.
+     */
+    static WeightStore load(Runtime runtime, const string &path);
+
+private:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+    size_t getAlignedSize(size_t size) const;
+};
+} // namespace infini
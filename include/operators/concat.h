@@ -28,5 +28,6 @@ class ConcatObj : public OperatorObj {
     int numInputs() const override { return inputs.size(); }
     int numOutputs() const override { return 1; }
     int getDim() const { return dim; }
+    vector<int> getOpAttrVector() const override;
 };
 } // namespace infini
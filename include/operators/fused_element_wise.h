@@ -0,0 +1,59 @@
+#pragma once
+#include "core/operator.h"
+
+namespace infini
+{
+  /**
+   * @brief One step of a FusedElementWiseObj program. Registers 0 to
+   * numInputs() - 1 hold the inputs and instruction i writes register
+   * numInputs() + i.
+   */
+  struct FusedInstr
+  {
+    // Add, Sub, Mul, Div, Relu or Clip
+    OpType type;
+    // registers read, rhs is -1 for Relu and Clip
+    int lhs, rhs;
+    // bounds of Clip
+    std::optional<float> min, max;
+  };
+
+  /**
+   * @brief A chain of element-wise operators evaluated in one pass over the
+   * output. The inputs are broadcast to the output shape and the last
+   * instruction writes the output.
+   */
+  class FusedElementWiseObj : public OperatorObj
+  {
+  public:
+    /**
+     * @brief Construct a new FusedElementWiseObj object.
+     *
+     * @param graph The graph to which this operator belongs.
+     * @param inputs The input tensors.
+     * @param output The output tensor.
+     * @param program The instructions, at least one.
+     */
+    FusedElementWiseObj(GraphObj *graph, TensorVec inputs, Tensor output,
+                        vector<FusedInstr> program);
+    OP_CLONE(FusedElementWiseObj);
+    optional<vector<Shape>> inferShape(const TensorVec &inputs) override;
+
+    std::string toString() const override;
+    int numInputs() const override { return inputs.size(); }
+    int numOutputs() const override { return 1; }
+    const vector<FusedInstr> &getProgram() const { return program; }
+    vector<int> getOpAttrVector() const override;
+
+    // whether operators of `type` can be part of a program
+    static bool canFuse(OpType type);
+    /**
+     * @brief The program computing the output of `op` from its inputs:
+     * the program of a FusedElementWiseObj, or a single instruction.
+     */
+    static vector<FusedInstr> programOf(const Operator &op);
+
+  private:
+    vector<FusedInstr> program;
+  };
+} // namespace infini
@@ -3,6 +3,17 @@
 
 namespace infini
 {
+    /**
+     * @brief Activation applied by the matmul to its result before storing
+     * it.
+     */
+    enum class ActType
+    {
+        None,
+        Relu,
+        Clip,
+    };
+
     /**
      * @brief Matrix multiplication.
      *
@@ -14,6 +25,18 @@ namespace infini
         // default dims, true means A should be transposed before matmul. This is in
         // oppsite to the column-major BLAS.
         bool transA, transB;
+        // The matmul reads A as transpose(A, permA) and B as transpose(B,
+        // permB), before transA/transB apply. Empty means no permutation.
+        vector<int> permA, permB;
+        // Epilogue on every element of C: bias add (the optional third input,
+        // broadcast along the last dimension), then the activation. Clip
+        // uses clipMin/clipMax, a missing bound does not clamp.
+        ActType act;
+        std::optional<float> clipMin, clipMax;
+        // Width of the column panels B is prepacked in, 0 if it is not. A
+        // packed B of logical dims {..., k, n} is stored as
+        // {..., n / panelB, k, panelB}, see GraphObj::prepack_weights().
+        int panelB;
 
         // Auxiliary attributes which are not a part of operator attributes.
         int m, n, k;
@@ -37,9 +60,16 @@ namespace infini
          * the constructor, C should be an empty Ref.
          * @param transA If matrix A should be transposed when computing.
          * @param transB If matrix B should be transposed when computing.
+         * @param permA Permutation A is read through, e.g. a folded transpose.
+         * @param permB Permutation B is read through.
+         * @param bias Optional bias of N elements added to every row of C.
+         * @param panelB Panel width of a prepacked B, 0 for a plain one. A
+         * packed B is read without transB and permB.
          */
         MatmulObj(GraphObj *graph, Tensor A, Tensor B, Tensor C,
-                  bool transA = false, bool transB = false);
+                  bool transA = false, bool transB = false,
+                  vector<int> permA = {}, vector<int> permB = {},
+                  Tensor bias = nullptr, int panelB = 0);
         OP_CLONE(MatmulObj);
 
         std::string toString() const override;
@@ -52,9 +82,24 @@ namespace infini
         bool getTransB() const { return transB; }
         void setTransA(bool transA) { this->transA = transA; }
         void setTransB(bool transB) { this->transB = transB; }
+        const vector<int> &getPermA() const { return permA; }
+        const vector<int> &getPermB() const { return permB; }
+        void setPermA(vector<int> permA);
+        void setPermB(vector<int> permB);
+        Tensor getBias() const
+        {
+            return inputs.size() > 2 ? inputs[2] : nullptr;
+        }
+        ActType getAct() const { return act; }
+        std::optional<float> getClipMin() const { return clipMin; }
+        std::optional<float> getClipMax() const { return clipMax; }
+        void setAct(ActType act, std::optional<float> min = std::nullopt,
+                    std::optional<float> max = std::nullopt);
+        int getPanelB() const { return panelB; }
         int getM() const { return m; }
         int getN() const { return n; }
         int getK() const { return k; }
+        vector<int> getOpAttrVector() const override;
     };
 
 } // namespace infini
\ No newline at end of file
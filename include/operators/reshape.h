@@ -0,0 +1,38 @@
+#pragma once
+#include "core/operator.h"
+
+namespace infini
+{
+  /**
+   * @brief Give the input tensor a new shape with the same number of
+   * elements. The data is not moved: dataMalloc() places the output in the
+   * memory of the input when both are in the activation arena.
+   *
+   */
+  class ReshapeObj : public OperatorObj
+  {
+  public:
+    /**
+     * @brief Construct a new ReshapeObj object.
+     *
+     * @param graph The graph to which this operator belongs.
+     * @param input The input tensor.
+     * @param output The output tensor.
+     * @param dims The shape of the output. A 0 copies the input dimension
+     * at the same axis, so that the output follows the input when its
+     * shape changes.
+     */
+    ReshapeObj(GraphObj *graph, Tensor input, Tensor output, Shape dims);
+    OP_CLONE(ReshapeObj);
+    optional<vector<Shape>> inferShape(const TensorVec &inputs) override;
+
+    std::string toString() const override;
+    int numInputs() const override { return 1; }
+    int numOutputs() const override { return 1; }
+    Shape getShape() const { return dims; }
+    vector<int> getOpAttrVector() const override;
+
+  private:
+    Shape dims;
+  };
+} // namespace infini
@@ -0,0 +1,41 @@
+#pragma once
+#include "core/operator.h"
+
+namespace infini {
+/**
+ * @brief Split a tensor into consecutive pieces along one dimension, the
+ * inverse of Concat. When every dimension before `dim` is 1 the pieces are
+ * contiguous, and dataMalloc() places them in the memory of the input
+ * instead of copying.
+ *
+ */
+class SplitObj : public OperatorObj {
+    int dim;
+    vector<int> sizes;
+
+  public:
+    /**
+     * @brief Construct a new Split object.
+     *
+     * @param graph The computation graph that this operator belongs to.
+     * @param input The tensor to split.
+     * @param outputs The pieces, or std::nullopt to create them.
+     * @param dim The dimension to split on.
+     * @param sizes The size of every piece along `dim`.
+     */
+    SplitObj(GraphObj *graph, Tensor input, std::optional<TensorVec> outputs,
+             int dim, vector<int> sizes);
+    OP_CLONE(SplitObj);
+
+    optional<vector<Shape>> inferShape(const TensorVec &inputs) override;
+
+    std::string toString() const override;
+    int numInputs() const override { return 1; }
+    int numOutputs() const override { return sizes.size(); }
+    int getDim() const { return dim; }
+    const vector<int> &getSizes() const { return sizes; }
+    // the pieces are contiguous slices of the input
+    bool isContiguous() const;
+    vector<int> getOpAttrVector() const override;
+};
+} // namespace infini
@@ -37,6 +37,7 @@ namespace infini
     std::string toString() const override;
     std::optional<float> getMin() const { return minValue; };
     std::optional<float> getMax() const { return maxValue; };
+    vector<int> getOpAttrVector() const override;
     int numInputs() const override { return 1; }
     int numOutputs() const override { return 1; }
 
@@ -84,6 +85,7 @@ namespace infini
     std::string toString() const override;
     CastType getType() const { return castType; }
     DataType getOutputDataType() const;
+    vector<int> getOpAttrVector() const override;
     int numInputs() const override { return 1; }
     int numOutputs() const override { return 1; }
 
@@ -18,6 +18,10 @@ Shape locate_index(size_t inputN, const Shape &shape);
 // Delocate the ShapeIndex from Shape with broadcast
 size_t delocate_index(const Shape &shapeIndex, const Shape &shape,
                       const Shape &stride);
+// Offset of the element at row-major position `index` of `shape` in data laid
+// out with `strides`, see TensorObj::getStrides()
+size_t strided_offset(size_t index, const Shape &shape,
+                      const vector<size_t> &strides);
 // Convert KernelAttrs to a string representation
 std::string get_kernel_attrs_str(const KernelAttrs &kernelAttrs);
 
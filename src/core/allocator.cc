@@ -5,9 +5,9 @@ namespace infini
 {
 Allocator::Allocator(Runtime runtime) : runtime(runtime)
 {
-    used = 0;
-    peak = 0;
     ptr = nullptr;
+    capacity = 0;
+    reset();
 
     // align to 64-bit
     alignment = sizeof(uint64_t);
@@ -24,9 +24,11 @@ Allocator::~Allocator()
 size_t Allocator::alloc(size_t size)
 {
     // planning phase only
-    IT_ASSERT(this->ptr == nullptr);
+    IT_ASSERT(this->planning, "Call reset() to re-plan");
 
     size = this->getAlignedSize(size);
+    numAllocs++;
+    requested += size;
 
     // ------------------------------------------------
     // 1. try reuse free blocks (first-fit)
@@ -45,24 +47,35 @@ size_t Allocator::alloc(size_t size)
             }
 
             used += size;
-            peak = std::max(peak, used);
+            maxUsed = std::max(maxUsed, used);
             return addr;
         }
     }
 
     // ------------------------------------------------
-    // 2. bump allocation
+    // 2. bump allocation, growing a free block that ends at the top
     // ------------------------------------------------
-    size_t addr = used;
+    size_t addr = top;
+    if (!freeBlocks.empty())
+    {
+        auto last = std::prev(freeBlocks.end());
+        if (last->first + last->second == top)
+        {
+            addr = last->first;
+            freeBlocks.erase(last);
+        }
+    }
+    top = addr + size;
     used += size;
-    peak = std::max(peak, used);
+    maxUsed = std::max(maxUsed, used);
+    peak = std::max(peak, top);
     return addr;
 }
 
 void Allocator::free(size_t addr, size_t size)
 {
     // planning phase only
-    IT_ASSERT(this->ptr == nullptr);
+    IT_ASSERT(this->planning, "Call reset() to re-plan");
 
     size = getAlignedSize(size);
     used -= size;
@@ -98,24 +111,82 @@ void Allocator::free(size_t addr, size_t size)
 
 void *Allocator::getPtr()
 {
-    if (this->ptr == nullptr)
+    // the arena only grows: a smaller plan keeps using the current memory
+    if (this->ptr == nullptr || this->peak > this->capacity)
     {
+        if (this->ptr != nullptr)
+        {
+            runtime->dealloc(this->ptr);
+        }
         this->ptr = runtime->alloc(this->peak);
-        printf("Allocator really alloc: %p %lu bytes\n", this->ptr, peak);
+        this->capacity = this->peak;
     }
+    this->planning = false;
     return this->ptr;
 }
 
-size_t Allocator::getAlignedSize(size_t size)
+void *Allocator::getPtr(size_t size)
+{
+    reset();
+    this->peak = size;
+    return getPtr();
+}
+
+void Allocator::reset()
+{
+    used = 0;
+    maxUsed = 0;
+    numAllocs = 0;
+    requested = 0;
+    top = 0;
+    peak = 0;
+    freeBlocks.clear();
+    planning = true;
+}
+
+size_t Allocator::getAlignedSize(size_t size) const
 {
     return ((size - 1) / this->alignment + 1) * this->alignment;
 }
 
-void Allocator::info()
+AllocatorStats Allocator::getStats() const
+{
+    AllocatorStats stats{};
+    stats.arenaSize = this->capacity;
+    stats.peak = this->peak;
+    stats.used = this->used;
+    stats.maxUsed = this->maxUsed;
+    stats.numAllocs = this->numAllocs;
+    stats.requested = this->requested;
+    for (auto &[addr, size] : freeBlocks)
+    {
+        // a block ending at the top is not a hole, the arena just shrinks
+        if (addr + size == top)
+            continue;
+        stats.numFreeBlocks++;
+        stats.freeBytes += size;
+        stats.largestFreeBlock = std::max(stats.largestFreeBlock, size);
+        size_t sizeClass = 1;
+        while (sizeClass < size)
+            sizeClass <<= 1;
+        stats.freeBlockHistogram[sizeClass]++;
+    }
+    return stats;
+}
+
+void Allocator::info() const
+{
+    std::cout << getStats().toString() << std::endl;
+}
+
+string AllocatorStats::toString() const
 {
-    std::cout << "Used memory: " << this->used
-              << ", peak memory: " << this->peak
-              << ", free blocks: " << freeBlocks.size()
-              << std::endl;
+    std::ostringstream oss;
+    oss << "Used memory: " << used << ", peak memory: " << peak
+        << ", max used: " << maxUsed << ", requested: " << requested
+        << " in " << numAllocs << " allocs, saved by reuse: " << bytesSaved()
+        << ", free blocks: " << numFreeBlocks << " (" << freeBytes
+        << " bytes, fragmentation " << fragmentation() << ")";
+    return oss.str();
 }
 }
@@ -1,5 +1,8 @@
 #include "core/graph.h"
-#include "operators/matmul.h"
+#include "core/kernel.h"
+#include "core/rewrite_rules.h"
+#include "operators/concat.h"
+#include "operators/split.h"
 #include "operators/transpose.h"
 #include <algorithm>
 #include <memory>
@@ -14,6 +17,9 @@ namespace infini
     void GraphObj::addOperatorAndConnect(const Operator &op)
     {
         sorted = false;
+        planCache.clear();
+        resizable.clear();
+        opSlots[op->getGuid()] = ops.size();
         ops.push_back(op);
         for (auto &input : op->getInputs())
         {
@@ -43,6 +49,7 @@ namespace infini
 
     string GraphObj::toString() const
     {
+        compact();
         std::ostringstream oss;
         oss << "Graph Tensors:\n";
         for (const auto &tensor : tensors)
@@ -66,416 +73,1500 @@ namespace infini
 
     bool GraphObj::topo_sort()
     {
+        compact();
         if (this->sorted)
         {
             return true;
         }
+        // Kahn's algorithm. Dependencies follow the tensors: an operator
+        // waits for the source of each of its inputs, and releases the
+        // targets of each of its outputs. The ready operator that comes first
+        // in the current order is taken first, so the result is deterministic
+        // and keeps the current order where it is already valid.
+        std::unordered_map<OperatorObj *, size_t> index;
+        index.reserve(ops.size());
+        for (size_t i = 0; i < ops.size(); ++i)
+            index[ops[i].get()] = i;
+        vector<int> inDegree(ops.size(), 0);
+        for (size_t i = 0; i < ops.size(); ++i)
+            for (auto &input : ops[i]->getInputs())
+                if (auto source = input->getSource();
+                    source && index.count(source.get()))
+                    inDegree[i]++;
+
+        std::priority_queue<size_t, vector<size_t>, std::greater<size_t>> ready;
+        for (size_t i = 0; i < ops.size(); ++i)
+            if (inDegree[i] == 0)
+                ready.push(i);
         std::vector<Operator> sorted;
-        std::unordered_set<OperatorObj *> flags;
         sorted.reserve(ops.size());
-        flags.reserve(ops.size());
-        while (sorted.size() < ops.size())
-        {
-            // Any node is move to sorted in this loop.
-            auto modified = false;
-            for (auto const &op : ops)
-            {
-                if (auto const &inputs = op->getInputs();
-                    flags.find(op.get()) == flags.end() &&
-                    std::all_of(inputs.begin(), inputs.end(),
-                                [&flags](auto const &input)
-                                {
-                                    auto ptr = input->getSource().get();
-                                    return !ptr || flags.find(ptr) != flags.end();
-                                }))
-                {
-                    modified = true;
-                    sorted.emplace_back(op);
-                    flags.insert(op.get());
-                }
+        while (!ready.empty())
+        {
+            auto &op = ops[ready.top()];
+            ready.pop();
+            sorted.emplace_back(op);
+            for (auto &output : op->getOutputs())
+                for (auto &target : output->getTargets())
+                    if (auto it = index.find(target.get());
+                        it != index.end() && --inDegree[it->second] == 0)
+                        ready.push(it->second);
+        }
+
+        cycleOps.clear();
+        if (sorted.size() < ops.size())
+        {
+            // peel off the operators that only lead into a cycle, what is
+            // left is on a cycle or between two
+            vector<int> outDegree(ops.size(), 0);
+            std::queue<size_t> sinks;
+            for (size_t i = 0; i < ops.size(); ++i)
+            {
+                if (inDegree[i] == 0)
+                    continue;
+                for (auto &input : ops[i]->getInputs())
+                    if (auto source = input->getSource())
+                        if (auto it = index.find(source.get());
+                            it != index.end() && inDegree[it->second] > 0)
+                            outDegree[it->second]++;
             }
-            if (!modified)
+            for (size_t i = 0; i < ops.size(); ++i)
+                if (inDegree[i] > 0 && outDegree[i] == 0)
+                    sinks.push(i);
+            vector<bool> peeled(ops.size(), false);
+            while (!sinks.empty())
             {
-                return false;
+                size_t i = sinks.front();
+                sinks.pop();
+                peeled[i] = true;
+                for (auto &input : ops[i]->getInputs())
+                    if (auto source = input->getSource())
+                        if (auto it = index.find(source.get());
+                            it != index.end() && inDegree[it->second] > 0 &&
+                            --outDegree[it->second] == 0)
+                            sinks.push(it->second);
             }
+            for (size_t i = 0; i < ops.size(); ++i)
+                if (inDegree[i] > 0 && !peeled[i])
+                    cycleOps.emplace_back(ops[i]);
+            return false;
         }
         this->ops = std::move(sorted);
+        reindex();
         return this->sorted = true;
     }
 
-    void GraphObj::optimize()
+    string GraphObj::cycleReport() const
     {
-        // =================================== 作业 ===================================
-        // TODO: 设计一个算法来实现指定的图优化规则
-        // 图优化规则如下：
-        // 1. 去除冗余的算子（例如，两个相邻的算子都是 transpose 算子，且做的是相反的操作，可以将其全部删除）
-        // 2. 合并算子（例如，矩阵乘算子中含有属性transA、transB，如果其输入存在transpose，且对最后两个维度做交换，就可以将transpose融入到矩阵乘算子的属性中去）
-        // =================================== 作业 ===================================
-
-        // 规则1：去除相邻的做相反操作的 transpose 算子
-        // 规则2：将 transpose 融入到 matmul 的 transA/transB 属性中
-
-        std::unordered_set<Operator> opsToRemove;
-        std::unordered_map<Tensor, Tensor> tensorReplacement; // old tensor -> new tensor
+        std::ostringstream oss;
+        oss << "Graph has a cycle through " << cycleOps.size() << " operators:";
+        for (auto &op : cycleOps)
+            oss << "\n  " << op;
+        return oss.str();
+    }
 
-        // 规则1: 检查相邻的 transpose 是否做相反操作
-        for (auto &op : ops)
+    namespace
+    {
+        /**
+         * @brief Operators and activation tensors of a graph in index form,
+         * for simulating the live bytes of an operator order.
+         */
+        struct ScheduleProblem
         {
-            if (opsToRemove.find(op) != opsToRemove.end())
-                continue;
+            // arena inputs (with repetition) and outputs of every operator
+            vector<vector<int>> opInputs, opOutputs;
+            // operators consuming each output of every operator
+            vector<vector<int>> opConsumers;
+            // number of inputs of every operator produced by another one
+            vector<int> inDegree;
+            vector<size_t> bytes;
+            // number of times every tensor is read
+            vector<int> uses;
+            // bytes of the graph inputs, live before the first operator
+            size_t inputBytes = 0;
 
-            if (op->getOpType() == OpType::Transpose)
+            ScheduleProblem(const OpVec &ops, const TensorVec &tensors,
+                            const Allocator &allocator)
             {
-                auto outputs = op->getOutputs();
-                if (!outputs.empty() && outputs[0]->getTargets().size() == 1)
+                std::unordered_map<TensorObj *, int> tensorIds;
+                std::unordered_map<TensorObj *, int> producers;
+                auto inArena = [](const Tensor &tensor)
+                { return tensor && !tensor->isWeight() && !tensor->isExternal(); };
+                for (auto &tensor : tensors)
                 {
-                    auto succ = outputs[0]->getTargets()[0];
-                    if (succ->getOpType() == OpType::Transpose && opsToRemove.find(succ) == opsToRemove.end())
+                    if (!inArena(tensor))
+                        continue;
+                    tensorIds[tensor.get()] = bytes.size();
+                    bytes.emplace_back(allocator.getAlignedSize(tensor->getBytes()));
+                }
+                uses.assign(bytes.size(), 0);
+                opInputs.resize(ops.size());
+                opOutputs.resize(ops.size());
+                opConsumers.resize(ops.size());
+                inDegree.assign(ops.size(), 0);
+                for (size_t i = 0; i < ops.size(); ++i)
+                    for (auto &output : ops[i]->getOutputs())
                     {
-                        auto transpose1 = as<TransposeObj>(op);
-                        auto transpose2 = as<TransposeObj>(succ);
-
-                        auto permute1 = transpose1->getPermute();
-                        auto permute2 = transpose2->getPermute();
-                        bool isInverse = true;
-
-                        if (permute1.size() == permute2.size())
-                        {
-                            for (size_t j = 0; j < permute1.size(); ++j)
-                            {
-                                if (permute2[permute1[j]] != (int)j)
-                                {
-                                    isInverse = false;
-                                    break;
-                                }
-                            }
-                        }
-                        else
+                        producers[output.get()] = i;
+                        if (tensorIds.count(output.get()))
+                            opOutputs[i].emplace_back(tensorIds[output.get()]);
+                    }
+                for (size_t i = 0; i < ops.size(); ++i)
+                    for (auto &input : ops[i]->getInputs())
+                    {
+                        auto it = producers.find(input.get());
+                        if (it != producers.end())
                         {
-                            isInverse = false;
+                            inDegree[i]++;
+                            opConsumers[it->second].emplace_back(i);
                         }
-
-                        if (isInverse)
+                        if (tensorIds.count(input.get()))
                         {
-                            // 标记两个 transpose 为删除
-                            opsToRemove.insert(op);
-                            opsToRemove.insert(succ);
-
-                            // 记录 tensor 替换：succ 的输出应该替换为 op 的输入
-                            auto opInput = op->getInputs()[0];
-                            auto succOutput = succ->getOutputs()[0];
-                            tensorReplacement[succOutput] = opInput;
+                            int id = tensorIds[input.get()];
+                            opInputs[i].emplace_back(id);
+                            uses[id]++;
                         }
                     }
-                }
+                for (auto &tensor : tensors)
+                    if (inArena(tensor) && !tensor->getSource())
+                        inputBytes += bytes[tensorIds[tensor.get()]];
             }
-        }
 
-        // 规则2: 检查 matmul 的输入是否有 transpose（只针对没有被规则1处理的 transpose）
-        for (auto &op : ops)
-        {
-            if (opsToRemove.find(op) != opsToRemove.end())
-                continue;
+            struct State
+            {
+                vector<int> order;
+                vector<int> inDegree;
+                vector<int> uses;
+                // operators whose inputs are all computed, ascending
+                vector<int> ready;
+                size_t live;
+                size_t peak;
+            };
 
-            if (op->getOpType() == OpType::MatMul)
+            State initialState() const
             {
-                auto matmulOp = as<MatmulObj>(op);
-                auto inputs = op->getInputs();
+                vector<int> ready;
+                for (size_t i = 0; i < inDegree.size(); ++i)
+                    if (inDegree[i] == 0)
+                        ready.emplace_back(i);
+                return {{}, inDegree, uses, std::move(ready), inputBytes,
+                        inputBytes};
+            }
 
-                // 检查第一个输入是否来自 transpose
-                if (inputs[0]->getSource())
-                {
-                    auto pred = inputs[0]->getSource();
-                    if (pred->getOpType() == OpType::Transpose &&
-                        opsToRemove.find(pred) == opsToRemove.end())
-                    {
-                        auto transposeOp = as<TransposeObj>(pred);
-                        auto permute = transposeOp->getPermute();
-                        int rank = permute.size();
+            // live bytes after running `op`, and the peak while running it
+            std::pair<size_t, size_t> simulate(const State &state, int op) const
+            {
+                size_t live = state.live;
+                for (int t : opOutputs[op])
+                    live += bytes[t];
+                size_t peak = live;
+                std::unordered_map<int, int> reads;
+                for (int t : opInputs[op])
+                    reads[t]++;
+                for (auto &[t, n] : reads)
+                    if (state.uses[t] == n)
+                        live -= bytes[t];
+                return {live, peak};
+            }
 
-                        // 检查是否交换最后两个维度
-                        if (rank >= 2 && permute[rank - 2] == rank - 1 && permute[rank - 1] == rank - 2)
-                        {
-                            bool otherDimsUnchanged = true;
-                            for (int j = 0; j < rank - 2; ++j)
-                            {
-                                if (permute[j] != j)
-                                {
-                                    otherDimsUnchanged = false;
-                                    break;
-                                }
-                            }
-
-                            if (otherDimsUnchanged)
-                            {
-                                matmulOp->setTransA(!matmulOp->getTransA());
-                                opsToRemove.insert(pred);
-                                tensorReplacement[inputs[0]] = pred->getInputs()[0];
-                            }
-                        }
-                    }
-                }
+            void apply(State &state, int op) const
+            {
+                auto [live, peak] = simulate(state, op);
+                state.live = live;
+                state.peak = std::max(state.peak, peak);
+                for (int t : opInputs[op])
+                    state.uses[t]--;
+                auto &ready = state.ready;
+                ready.erase(std::lower_bound(ready.begin(), ready.end(), op));
+                // a consumer is listed once per input it reads from `op`, and
+                // becomes ready on the last one
+                for (int c : opConsumers[op])
+                    if (--state.inDegree[c] == 0)
+                        ready.insert(
+                            std::lower_bound(ready.begin(), ready.end(), c), c);
+                state.inDegree[op] = -1;
+                state.order.emplace_back(op);
+            }
+        };
+    } // namespace
 
-                // 检查第二个输入是否来自 transpose
-                if (inputs[1]->getSource())
-                {
-                    auto pred = inputs[1]->getSource();
-                    if (pred->getOpType() == OpType::Transpose &&
-                        opsToRemove.find(pred) == opsToRemove.end())
-                    {
-                        auto transposeOp = as<TransposeObj>(pred);
-                        auto permute = transposeOp->getPermute();
-                        int rank = permute.size();
+    size_t GraphObj::estimatePeak() const
+    {
+        compact();
+        ScheduleProblem problem(ops, tensors, allocator);
+        auto state = problem.initialState();
+        // Rewrites append their operators at the end, so `ops` need not be
+        // in topological order here. Simulate the order topo_sort() would
+        // give instead: the ready operator that comes first runs next.
+        while (!state.ready.empty())
+            problem.apply(state, state.ready.front());
+        return state.peak;
+    }
 
-                        if (rank >= 2 && permute[rank - 2] == rank - 1 && permute[rank - 1] == rank - 2)
-                        {
-                            bool otherDimsUnchanged = true;
-                            for (int j = 0; j < rank - 2; ++j)
-                            {
-                                if (permute[j] != j)
-                                {
-                                    otherDimsUnchanged = false;
-                                    break;
-                                }
-                            }
-
-                            if (otherDimsUnchanged)
-                            {
-                                matmulOp->setTransB(!matmulOp->getTransB());
-                                opsToRemove.insert(pred);
-                                tensorReplacement[inputs[1]] = pred->getInputs()[0];
-                            }
-                        }
-                    }
+    ScheduleReport GraphObj::memory_aware_sort(size_t beamWidth,
+                                               size_t maxBeamOps)
+    {
+        IT_ASSERT(topo_sort() == true, cycleReport());
+        ScheduleProblem problem(ops, tensors, allocator);
+        using State = ScheduleProblem::State;
+
+        // the current order is the baseline
+        State best = problem.initialState();
+        for (size_t i = 0; i < ops.size(); ++i)
+            problem.apply(best, i);
+        ScheduleReport report{best.peak, best.peak};
+
+        // greedy: run the ready operator that frees the most bytes net of
+        // what it allocates, the earliest one on ties
+        State greedy = problem.initialState();
+        for (size_t step = 0; step < ops.size(); ++step)
+        {
+            int pick = -1;
+            long long bestScore = 0;
+            for (int op : greedy.ready)
+            {
+                auto [live, peak] = problem.simulate(greedy, op);
+                long long score = (long long)greedy.live - (long long)live;
+                if (pick < 0 || score > bestScore)
+                {
+                    pick = op;
+                    bestScore = score;
                 }
             }
+            problem.apply(greedy, pick);
         }
+        if (greedy.peak < best.peak)
+            best = std::move(greedy);
 
-        // 应用 tensor 替换：更新所有算子的输入
-        for (auto &op : ops)
+        // beam search over partial orders, ranked by peak then live bytes
+        if (beamWidth > 0 && ops.size() <= maxBeamOps)
         {
-            if (opsToRemove.find(op) == opsToRemove.end())
+            auto better = [](const State &a, const State &b)
+            { return tie(a.peak, a.live) < tie(b.peak, b.live); };
+            vector<State> beam{problem.initialState()};
+            for (size_t step = 0; step < ops.size(); ++step)
             {
-                for (auto &input : op->getInputs())
+                // states that ran the same set of operators are equivalent,
+                // keep the best one
+                std::map<vector<int>, State> next;
+                for (auto &state : beam)
                 {
-                    auto it = tensorReplacement.find(input);
-                    if (it != tensorReplacement.end())
+                    for (int op : state.ready)
                     {
-                        op->replaceInput(input, it->second);
+                        State child = state;
+                        problem.apply(child, op);
+                        auto it = next.find(child.inDegree);
+                        if (it == next.end())
+                            next.emplace(child.inDegree, std::move(child));
+                        else if (better(child, it->second))
+                            it->second = std::move(child);
                     }
                 }
+                beam.clear();
+                for (auto &[key, state] : next)
+                    beam.emplace_back(std::move(state));
+                std::sort(beam.begin(), beam.end(), better);
+                if (beam.size() > beamWidth)
+                    beam.resize(beamWidth);
             }
+            if (beam.front().peak < best.peak)
+                best = std::move(beam.front());
         }
 
-        // 更新 tensor 的 targets 列表：被替换的 tensor 应该把目标算子添加到新 tensor
-        for (auto &p : tensorReplacement)
+        if (best.peak < report.peakBefore)
         {
-            auto oldTensor = p.first;
-            auto newTensor = p.second;
-            // 找到所有使用 oldTensor 的后续算子
-            for (auto &targetOp : oldTensor->getTargets())
-            {
-                if (opsToRemove.find(targetOp) == opsToRemove.end())
-                {
-                    // 将 targetOp 添加到 newTensor 的 targets 中
-                    newTensor->addTarget(targetOp);
-                }
-            }
+            OpVec order;
+            for (int i : best.order)
+                order.emplace_back(ops[i]);
+            ops = std::move(order);
+            reindex();
+            invalidatePlan();
+            report.peakAfter = best.peak;
         }
+        return report;
+    }
+
+    void GraphObj::optimize()
+    {
+        // =================================== 作业 ===================================
+        // 图优化规则如下：
+        // 1. 去除冗余的算子（例如，两个相邻的算子都是 transpose 算子，且做的是相反的操作，可以将其全部删除）
+        // 2. 合并算子（例如，矩阵乘算子中含有属性transA、transB，如果其输入存在transpose，且对最后两个维度做交换，就可以将transpose融入到矩阵乘算子的属性中去）
+        // =================================== 作业 ===================================
+        // Each rule is a RewriteRule in core/rewrite_rules.h.
+        GraphRewriter rewriter;
+        rewriter.addRule<ComposeTransposeRule>();
+        rewriter.addRule<TransposeToReshapeRule>();
+        rewriter.addRule<FoldTransposeIntoMatmulRule>(0);
+        rewriter.addRule<FoldTransposeIntoMatmulRule>(1);
+        for (auto type : {OpType::Relu, OpType::Clip, OpType::Cast})
+            rewriter.addRule<SinkTransposeThroughUnaryRule>(type);
+        for (auto type : {OpType::Add, OpType::Sub, OpType::Mul, OpType::Div})
+            rewriter.addRule<SinkTransposeThroughElementWiseRule>(type);
+        rewriter.addRule<SinkTransposeThroughConcatRule>();
+        for (auto outer : {OpType::Relu, OpType::Clip})
+            for (auto inner : {OpType::Relu, OpType::Clip})
+                rewriter.addRule<MergeClampsRule>(outer, inner);
+        for (auto type : {OpType::Clip, OpType::Cast, OpType::Add, OpType::Sub,
+                          OpType::Mul, OpType::Div})
+            rewriter.addRule<RemoveIdentityRule>(type);
+        rewriter.addRule<RemoveCastRoundTripRule>();
+        rewriter.addRule<FuseBiasIntoMatmulRule>();
+        for (auto type : {OpType::Relu, OpType::Clip})
+            rewriter.addRule<FuseActivationIntoMatmulRule>(type);
+        rewriter.run(*this);
+    }
+
+    size_t GraphObj::fuse_sibling_matmuls()
+    {
+        GraphRewriter rewriter;
+        rewriter.addRule<FuseSiblingMatmulsRule>();
+        return rewriter.run(*this);
+    }
+
+    size_t GraphObj::prepack_weights()
+    {
+        // the widest panel that divides n
+        GraphRewriter rewriter;
+        for (int panel : {8, 4})
+            rewriter.addRule<PrepackMatmulWeightsRule>(panel);
+        size_t packed = rewriter.run(*this);
+        if (packed)
+            fold_constants();
+        return packed;
+    }
+
+    size_t GraphObj::fuse_element_wise()
+    {
+        // a separate run, so the fused operators do not hide patterns from
+        // the rules of optimize()
+        GraphRewriter rewriter;
+        for (auto type : {OpType::Add, OpType::Sub, OpType::Mul, OpType::Div,
+                          OpType::Relu, OpType::Clip,
+                          OpType::FusedElementWise})
+            rewriter.addRule<FuseElementWiseRule>(type);
+        return rewriter.run(*this);
+    }
+
+    size_t GraphObj::fold_constants()
+    {
+        IT_ASSERT(topo_sort() == true, cycleReport());
+        const auto &registry = KernelRegistry::getInstance();
 
-        // 清理将被删除的 operator 关联的 tensor 的 source 指针
-        for (auto &opToRemove : opsToRemove)
+        // operators to fold, in order, and the outputs that get computed
+        OpVec folded;
+        std::unordered_set<Operator> isFolded;
+        std::unordered_set<Tensor> computed;
+        for (auto &op : ops)
         {
-            // 清理输出 tensor 的 source 指针
-            for (auto &output : opToRemove->getOutputs())
+            bool foldable = registry.hasKernel(
+                {runtime->getDevice(), op->getOpType().underlying()});
+            for (auto &input : op->getInputs())
+                foldable &= (input->isConstant() && input->hasData()) ||
+                            computed.count(input);
+            for (auto &output : op->getOutputs())
+                foldable &= !isOutput(output);
+            if (!foldable)
+                continue;
+            folded.emplace_back(op);
+            isFolded.insert(op);
+            for (auto &output : op->getOutputs())
+                computed.insert(output);
+        }
+        if (folded.empty())
+            return 0;
+
+        // Outputs still read by the rest of the graph become constants in
+        // the weight store, taking slots after the weights like
+        // weightMalloc() does; the others only live until folding is done.
+        TensorVec kept, scratch;
+        vector<size_t> slots;
+        for (auto &op : folded)
+            for (auto &output : op->getOutputs())
             {
-                if (output && output->getSource() == opToRemove)
+                bool readLater = false;
+                for (auto &target : output->getTargets())
+                    readLater |= !isFolded.count(target);
+                if (!readLater)
                 {
-                    output->setSource(nullptr);
+                    scratch.emplace_back(output);
+                    continue;
                 }
+                size_t slot = boundWeights++;
+                if (slot < weightStore->numSlots())
+                    IT_ASSERT(weightStore->getSlotBytes(slot) ==
+                              output->getBytes());
+                else
+                    IT_ASSERT(weightStore->reserve(output->getBytes()) == slot);
+                kept.emplace_back(output);
+                slots.emplace_back(slot);
             }
+        weightStore->materialize();
+        std::unordered_set<Tensor> readOnly;
+        for (size_t i = 0; i < kept.size(); ++i)
+        {
+            kept[i]->setConstant();
+            kept[i]->setStrides({});
+            kept[i]->setDataBlob(
+                make_ref<BlobObj>(runtime, weightStore->getPtr(slots[i])));
+            // already computed by the instance that saved the store
+            if (weightStore->isReadOnly(slots[i]))
+                readOnly.insert(kept[i]);
+        }
+        vector<void *> buffers;
+        for (auto &tensor : scratch)
+        {
+            buffers.emplace_back(runtime->alloc(tensor->getBytes()));
+            tensor->setStrides({});
+            tensor->setDataBlob(make_ref<BlobObj>(runtime, buffers.back()));
         }
 
-        // 从剩余 operator 的 predecessor/successor 列表中移除被删除的 operator
-        for (auto &op : ops)
+        for (auto &op : folded)
         {
-            if (opsToRemove.find(op) == opsToRemove.end())
+            bool done = true;
+            for (auto &output : op->getOutputs())
+                done &= readOnly.count(output) > 0;
+            if (!done)
+                registry
+                    .getKernel({runtime->getDevice(), op->getOpType().underlying()})
+                    ->compute(op, runtime.get());
+        }
+        for (auto buffer : buffers)
+            runtime->dealloc(buffer);
+
+        // disconnect the folded operators, their outputs become graph inputs
+        for (auto &op : folded)
+        {
+            for (auto &input : op->getInputs())
             {
-                for (auto &opToRemove : opsToRemove)
-                {
-                    op->removePredecessors(opToRemove);
-                    op->removeSuccessors(opToRemove);
-                }
+                input->removeTarget(op);
+                if (auto pred = input->getSource())
+                    pred->removeSuccessors(op);
             }
+            for (auto &output : op->getOutputs())
+            {
+                output->setSource(nullptr);
+                for (auto &succ : output->getTargets())
+                    succ->removePredecessors(op);
+            }
+            removeOperator(op);
         }
+        for (auto &tensor : tensors)
+            if (tensor && !tensor->getSource() && tensor->getTargets().empty())
+                removeTensor(tensor);
+        compactWeights();
+        return folded.size();
+    }
 
-        // 创建一个新的算子列表，只包含未被删除的算子
-        OpVec newOps;
-        for (auto &op : ops)
+    namespace
+    {
+        // what an operator computes: its attribute vector and the guids of
+        // its inputs
+        using OpKey = std::pair<vector<int>, vector<UidBaseType>>;
+
+        struct OpKeyHash
         {
-            if (opsToRemove.find(op) == opsToRemove.end())
+            size_t operator()(const OpKey &key) const
             {
-                newOps.push_back(op);
+                size_t seed = key.first.size() ^ (key.second.size() << 16);
+                auto combine = [&](size_t v)
+                { seed ^= v + 0x9e3779b9 + (seed << 6) + (seed >> 2); };
+                for (auto v : key.first)
+                    combine(std::hash<int>()(v));
+                for (auto v : key.second)
+                    combine(std::hash<UidBaseType>()(v));
+                return seed;
             }
-        }
-        ops = std::move(newOps);
+        };
+    } // namespace
 
-        // 清理不再使用的 tensor（只保留作为剩余算子的输入/输出的tensor）
-        std::unordered_set<Tensor> usedTensors;
+    size_t GraphObj::eliminate_common_subexpressions()
+    {
+        // readers come after their producers, so they are keyed on the
+        // surviving inputs once their producers are merged
+        IT_ASSERT(topo_sort() == true, cycleReport());
+        std::unordered_map<OpKey, Operator, OpKeyHash> seen;
+        OpVec duplicates;
         for (auto &op : ops)
         {
+            OpKey key{op->getOpAttrVector(), {}};
             for (auto &input : op->getInputs())
-                if (input) usedTensors.insert(input);
+                key.second.emplace_back(input->getGuid());
+            auto [it, inserted] = seen.try_emplace(std::move(key), op);
+            if (inserted)
+                continue;
+            // graph outputs have to keep their producer
+            bool isGraphOutput = false;
             for (auto &output : op->getOutputs())
-                if (output) usedTensors.insert(output);
+                isGraphOutput |= isOutput(output);
+            if (isGraphOutput)
+                continue;
+            auto &survivor = it->second;
+            for (size_t i = 0; i < op->getOutputs().size(); ++i)
+                replaceAllUses(op->getOutput(i), survivor->getOutput(i));
+            duplicates.emplace_back(op);
         }
+        for (auto &op : duplicates)
+            eraseOperator(op);
+        return duplicates.size();
+    }
 
-        TensorVec newTensors;
-        for (auto &t : tensors)
+    void GraphObj::setOutputs(const TensorVec &outputs)
+    {
+        for (auto &tensor : outputs)
+            IT_ASSERT(hasTensor(tensor));
+        declaredOutputs = outputs;
+        planCache.clear();
+    }
+
+    bool GraphObj::isOutput(const Tensor &tensor) const
+    {
+        if (declaredOutputs.empty())
+            return tensor->getTargets().empty();
+        return std::find(declaredOutputs.begin(), declaredOutputs.end(),
+                         tensor) != declaredOutputs.end();
+    }
+
+    vector<bool> GraphObj::opsNeededFor(const TensorVec &outputs) const
+    {
+        compact();
+        vector<bool> needed(ops.size(), false);
+        TensorVec stack = outputs;
+        while (!stack.empty())
+        {
+            auto tensor = stack.back();
+            stack.pop_back();
+            auto source = tensor->getSource();
+            if (!source)
+                continue;
+            auto slot = opSlots.at(source->getGuid());
+            if (needed[slot])
+                continue;
+            needed[slot] = true;
+            for (auto &input : source->getInputs())
+                stack.emplace_back(input);
+        }
+        return needed;
+    }
+
+    size_t GraphObj::eliminate_dead_code()
+    {
+        auto outputs = getOutputs();
+        auto needed = opsNeededFor(outputs);
+        std::unordered_set<Tensor> live(outputs.begin(), outputs.end());
+        OpVec dead;
+        for (size_t i = 0; i < ops.size(); ++i)
+        {
+            if (!needed[i])
+            {
+                dead.emplace_back(ops[i]);
+                continue;
+            }
+            for (auto &input : ops[i]->getInputs())
+                live.insert(input);
+            for (auto &output : ops[i]->getOutputs())
+                live.insert(output);
+        }
+        for (auto &op : dead)
         {
-            // 保留被使用的tensor，或者没有source的输入tensor
-            if (usedTensors.find(t) != usedTensors.end())
+            // live tensors read by dead operators lose those readers
+            for (auto &input : op->getInputs())
             {
-                newTensors.push_back(t);
+                input->removeTarget(op);
+                if (auto pred = input->getSource())
+                    pred->removeSuccessors(op);
             }
+            removeOperator(op);
         }
-        tensors = std::move(newTensors);
+        for (auto &tensor : tensors)
+            if (tensor && !live.count(tensor))
+                removeTensor(tensor);
+        compactWeights();
+        return dead.size();
+    }
+
+    bool GraphObj::isResizable(const Tensor &tensor) const
+    {
+        // memoized over the upstream cone, so the queries of a rewrite pass
+        // walk every tensor once until the graph changes
+        std::unordered_set<UidBaseType> expanded;
+        TensorVec stack{tensor};
+        while (!stack.empty())
+        {
+            auto t = stack.back();
+            auto guid = t->getGuid();
+            if (resizable.count(guid))
+            {
+                stack.pop_back();
+                continue;
+            }
+            auto op = t->getSource();
+            if (!op)
+            {
+                resizable[guid] = !t->isWeight();
+                stack.pop_back();
+                continue;
+            }
+            if (expanded.insert(guid).second)
+            {
+                bool pending = false;
+                for (auto &input : op->getInputs())
+                    if (!resizable.count(input->getGuid()))
+                    {
+                        stack.emplace_back(input);
+                        pending = true;
+                    }
+                if (pending)
+                    continue;
+            }
+            // the inputs are resolved, except the ones on a cycle
+            bool any = false;
+            for (auto &input : op->getInputs())
+            {
+                auto it = resizable.find(input->getGuid());
+                any |= it != resizable.end() && it->second;
+            }
+            resizable[guid] = any;
+            stack.pop_back();
+        }
+        return resizable.at(tensor->getGuid());
+    }
+
+    void GraphObj::compactWeights()
+    {
+        // another instance or a mapped file may still use the slots as they
+        // are
+        if (boundWeights == 0 || weightStore.use_count() > 1)
+            return;
+        std::unordered_map<void *, size_t> slotOf;
+        for (size_t slot = 0; slot < weightStore->numSlots(); ++slot)
+        {
+            if (weightStore->isReadOnly(slot))
+                return;
+            slotOf[weightStore->getPtr(slot)] = slot;
+        }
+        compact();
+        TensorVec live;
+        for (auto &tensor : tensors)
+            if (tensor->isWeight() && tensor->hasData() &&
+                slotOf.count(tensor->getRawDataPtr<void *>()))
+                live.emplace_back(tensor);
+        if (live.size() == weightStore->numSlots())
+            return;
+
+        // the live weights move to a new store in tensor order, the old one
+        // is freed with its dead slots
+        auto store = make_ref<WeightStoreObj>(runtime);
+        for (auto &tensor : live)
+            store->reserve(tensor->getBytes());
+        store->materialize();
+        for (size_t slot = 0; slot < live.size(); ++slot)
+        {
+            std::memcpy(store->getPtr(slot),
+                        live[slot]->getRawDataPtr<void *>(),
+                        live[slot]->getBytes());
+            live[slot]->setDataBlob(
+                make_ref<BlobObj>(runtime, store->getPtr(slot)));
+        }
+        weightStore = std::move(store);
+        boundWeights = live.size();
+    }
 
-        // 更新 sorted 标志
+    void GraphObj::replaceInput(const Operator &op, const Tensor &from,
+                                const Tensor &to)
+    {
+        IT_ASSERT(hasOperator(op) && hasTensor(from) && hasTensor(to));
+        auto &inputs = op->getInputs();
+        // an operator reading `from` several times is a target once per read
+        auto reads = std::count(inputs.begin(), inputs.end(), from);
+        IT_ASSERT(reads > 0);
+        op->replaceInput(from, to);
+        from->removeTarget(op);
+        for (int i = 0; i < reads; ++i)
+            to->addTarget(op);
+        if (auto pred = from->getSource())
+        {
+            bool stillRead = false;
+            for (auto &input : inputs)
+                stillRead |= input->getSource() == pred;
+            if (!stillRead)
+            {
+                pred->removeSuccessors(op);
+                op->removePredecessors(pred);
+            }
+        }
+        if (auto pred = to->getSource())
+        {
+            auto preds = op->getPredecessors();
+            if (std::find(preds.begin(), preds.end(), pred) == preds.end())
+            {
+                pred->addSuccessors(op);
+                op->addPredecessors(pred);
+            }
+        }
+        if (!from->getSource() && from->getTargets().empty())
+            removeTensor(from);
         sorted = false;
+        planCache.clear();
+        resizable.clear();
     }
 
-    Tensor GraphObj::getTensor(int fuid) const
+    void GraphObj::replaceAllUses(const Tensor &from, const Tensor &to)
     {
-        for (auto tensor : tensors)
+        // the first replaceInput() rewires every read of an operator
+        OpVec readers;
+        for (auto &op : from->getTargets())
+            if (std::find(readers.begin(), readers.end(), op) == readers.end())
+                readers.emplace_back(op);
+        for (auto &op : readers)
+            replaceInput(op, from, to);
+    }
+
+    void GraphObj::replaceOperator(const Operator &op,
+                                   const Operator &replacement)
+    {
+        replaceOperators({op}, replacement);
+    }
+
+    void GraphObj::replaceOperators(const OpVec &replaced,
+                                    const Operator &replacement)
+    {
+        IT_ASSERT(!hasOperator(replacement));
+        TensorVec outputs;
+        for (auto &op : replaced)
         {
-            if (tensor->getFuid() == fuid)
+            IT_ASSERT(hasOperator(op));
+            for (auto &output : op->getOutputs())
+                outputs.emplace_back(output);
+        }
+        IT_ASSERT(outputs == replacement->getOutputs());
+        for (auto &op : replaced)
+        {
+            for (auto &input : op->getInputs())
             {
-                return tensor;
+                input->removeTarget(op);
+                if (auto pred = input->getSource())
+                    pred->removeSuccessors(op);
             }
+            for (auto &succ : op->getSuccessors())
+                succ->removePredecessors(op);
+            removeOperator(op);
         }
-        return nullptr;
+        addOperatorAndConnect(replacement);
+        for (auto &op : replaced)
+            for (auto &input : op->getInputs())
+                if (hasTensor(input) && !input->getSource() &&
+                    input->getTargets().empty())
+                    removeTensor(input);
     }
 
-    void GraphObj::shape_infer()
+    void GraphObj::eraseOperator(const Operator &op)
     {
+        IT_ASSERT(hasOperator(op));
+        for (auto &output : op->getOutputs())
+        {
+            IT_ASSERT(isUnused(output),
+                      "Erasing an operator whose output is still used");
+            removeTensor(output);
+        }
+        for (auto &input : op->getInputs())
+        {
+            input->removeTarget(op);
+            if (auto pred = input->getSource())
+                pred->removeSuccessors(op);
+            if (!input->getSource() && input->getTargets().empty())
+                removeTensor(input);
+        }
+        removeOperator(op);
+        sorted = false;
+    }
+
+    Tensor GraphObj::getTensor(int fuid) const
+    {
+        auto it = fuidSlots.find(fuid);
+        return it == fuidSlots.end() ? nullptr : tensors[it->second];
+    }
+
+    bool GraphObj::hasTensor(const Tensor &tensor) const
+    {
+        auto it = tensorSlots.find(tensor->getGuid());
+        return it != tensorSlots.end() && tensors[it->second] == tensor;
+    }
+
+    bool GraphObj::hasOperator(const Operator &op) const
+    {
+        auto it = opSlots.find(op->getGuid());
+        return it != opSlots.end() && ops[it->second] == op;
+    }
+
+    void GraphObj::removeOperator(Operator op)
+    {
+        if (!hasOperator(op))
+            return;
+        auto it = opSlots.find(op->getGuid());
+        ops[it->second] = nullptr;
+        opSlots.erase(it);
+        tombstones++;
+        planCache.clear();
+        resizable.clear();
+    }
+
+    void GraphObj::removeTensor(Tensor tensor)
+    {
+        if (!hasTensor(tensor))
+            return;
+        auto it = tensorSlots.find(tensor->getGuid());
+        tensors[it->second] = nullptr;
+        tensorSlots.erase(it);
+        fuidSlots.erase(tensor->getFuid());
+        tombstones++;
+        planCache.clear();
+    }
+
+    void GraphObj::compact() const
+    {
+        if (tombstones == 0)
+            return;
+        tensors.erase(std::remove(tensors.begin(), tensors.end(), nullptr),
+                      tensors.end());
+        ops.erase(std::remove(ops.begin(), ops.end(), nullptr), ops.end());
+        tombstones = 0;
+        reindex();
+    }
+
+    void GraphObj::reindex() const
+    {
+        tensorSlots.clear();
+        fuidSlots.clear();
+        opSlots.clear();
+        for (size_t i = 0; i < tensors.size(); ++i)
+        {
+            tensorSlots[tensors[i]->getGuid()] = i;
+            fuidSlots[tensors[i]->getFuid()] = i;
+        }
+        for (size_t i = 0; i < ops.size(); ++i)
+            opSlots[ops[i]->getGuid()] = i;
+    }
+
+    TensorVec GraphObj::shape_infer()
+    {
+        compact();
+        std::unordered_set<OperatorObj *> all;
+        for (auto &op : ops)
+            all.insert(op.get());
+        return inferShapesOf(std::move(all));
+    }
+
+    TensorVec GraphObj::shape_infer(const TensorVec &changed)
+    {
+        compact();
+        std::unordered_set<OperatorObj *> dirty;
+        for (auto &tensor : changed)
+            for (auto &op : tensor->getTargets())
+                dirty.insert(op.get());
+        return inferShapesOf(std::move(dirty));
+    }
+
+    TensorVec GraphObj::inferShapesOf(std::unordered_set<OperatorObj *> dirty)
+    {
+        IT_ASSERT(topo_sort() == true, cycleReport());
+        TensorVec changed;
         for (auto &op : ops)
         {
+            if (!dirty.count(op.get()))
+                continue;
             auto ans = op->inferShape();
             IT_ASSERT(ans.has_value());
-            auto oldOutputs = op->getOutputs();
-            IT_ASSERT(ans.value().size() == oldOutputs.size());
-            // replace the old outputshape and size with new one
-            for (int i = 0; i < (int)ans.value().size(); ++i)
-            {
-                auto newShape = ans.value()[i];
-                auto oldShape = oldOutputs[i]->getDims();
-                auto fuid = oldOutputs[i]->getFuid();
-                if (newShape != oldShape)
+            auto outputs = op->getOutputs();
+            IT_ASSERT(ans.value().size() == outputs.size());
+            // readers of a reshaped output are inferred again, the others
+            // are left as they are
+            for (size_t i = 0; i < outputs.size(); ++i)
+            {
+                if (ans.value()[i] == outputs[i]->getDims())
+                    continue;
+                outputs[i]->setShape(ans.value()[i]);
+                changed.emplace_back(outputs[i]);
+                for (auto &target : outputs[i]->getTargets())
+                    dirty.insert(target.get());
+            }
+        }
+        return changed;
+    }
+
+    namespace
+    {
+        /**
+         * @brief Pick the activation that stays idle for longest across the
+         * step with the most live bytes, and spill it over that interval.
+         * Returns false if no tensor can be spilled there.
+         */
+        bool spillLongestIdle(vector<Lifetime> &lifetimes, int numOps,
+                              const Allocator &allocator)
+        {
+            vector<size_t> live(numOps + 2, 0);
+            for (auto &l : lifetimes)
+            {
+                size_t bytes = allocator.getAlignedSize(l.tensor->getBytes());
+                for (int step = l.start; step <= l.end; ++step)
+                    if (l.liveAt(step))
+                        live[step + 1] += bytes;
+            }
+            int fullest = std::max_element(live.begin(), live.end()) -
+                          live.begin() - 1;
+
+            Lifetime *victim = nullptr;
+            int victimFrom = 0, victimTo = 0;
+            for (auto &l : lifetimes)
+            {
+                // graph inputs are written by the caller before run(), and
+                // the spill file only moves the owner of a shared block
+                if (l.start < 0 || l.spilled() || !l.aliases.empty())
+                    continue;
+                for (size_t i = 0; i + 1 < l.accesses.size(); ++i)
                 {
-                    auto tensor = this->getTensor(fuid);
-                    tensor->setShape(newShape);
+                    int from = l.accesses[i], to = l.accesses[i + 1];
+                    if (!(from < fullest && fullest < to))
+                        continue;
+                    if (!victim || to - from > victimTo - victimFrom ||
+                        (to - from == victimTo - victimFrom &&
+                         l.tensor->getBytes() > victim->tensor->getBytes()))
+                    {
+                        victim = &l;
+                        victimFrom = from;
+                        victimTo = to;
+                    }
                 }
             }
+            if (!victim)
+                return false;
+            victim->spillAfter = victimFrom;
+            victim->reloadAt = victimTo;
+            return true;
+        }
+        // Kernels that read their inputs through TensorObj::getStrides(), so
+        // an input of theirs can be a strided view.
+        bool readsStrided(const Operator &op)
+        {
+            switch (op->getOpType().underlying())
+            {
+            case OpType::Add:
+            case OpType::Sub:
+            case OpType::Mul:
+            case OpType::Div:
+            case OpType::Relu:
+            case OpType::Clip:
+            case OpType::MatMul:
+            case OpType::Concat:
+            case OpType::Transpose:
+                return true;
+            default:
+                return false;
+            }
         }
-    }
+
+        struct Alias
+        {
+            Tensor owner;
+            size_t offset;
+            vector<size_t> strides;
+        };
+
+        /**
+         * @brief The tensor in whose block `tensor` can be placed, its byte
+         * offset there and the strides `tensor` is read with, or a nullptr
+         * owner if it needs a block of its own. Both must be in the arena.
+         * Transposes and non-contiguous split pieces become strided views only
+         * if `viewable(tensor)`.
+         */
+        Alias findAlias(const Tensor &tensor,
+                        const std::function<bool(const Tensor &)> &viewable)
+        {
+            auto op = tensor->getSource();
+            if (!op)
+                return {nullptr, 0, {}};
+            auto input = op->getInputs(0);
+            if (input->isWeight() || input->isExternal())
+                return {nullptr, 0, {}};
+            auto inStrides = input->getStrides();
+            if (op->getOpType() == OpType::Reshape && input->isContiguous())
+                return {input, 0, {}};
+            // bindInput() may move a graph input after planning, and the
+            // kernel would then write a contiguous copy under the strides of
+            // the view, so only produced tensors are viewed
+            bool fixed = input->getSource() != nullptr;
+            if (op->getOpType() == OpType::Transpose && fixed &&
+                viewable(tensor))
+            {
+                auto perm = as<TransposeObj>(op)->getPermute();
+                vector<size_t> strides;
+                for (auto axis : perm)
+                    strides.emplace_back(inStrides[axis]);
+                return {input, 0, strides};
+            }
+            // a piece of a split starts after the pieces before it along the
+            // split axis
+            if (op->getOpType() == OpType::Split &&
+                (as<SplitObj>(op)->isContiguous() ||
+                 (fixed && viewable(tensor))))
+            {
+                int dim = as<SplitObj>(op)->getDim();
+                size_t start = 0;
+                for (auto &output : op->getOutputs())
+                {
+                    if (output == tensor)
+                        return {input,
+                                start * inStrides[dim] *
+                                    tensor->getDType().getSize(),
+                                inStrides};
+                    start += output->getDims()[dim];
+                }
+            }
+            return {nullptr, 0, {}};
+        }
+
+        /**
+         * @brief Inputs of concats along their outermost non-trivial axis
+         * that can be written straight into the concat output, with the
+         * concat output and their byte offset in it. Such an input must be
+         * read by the concat only and must not share the block of another
+         * tensor already.
+         */
+        std::unordered_map<TensorObj *, std::pair<Tensor, size_t>>
+        inPlaceConcatInputs(const OpVec &ops,
+                            const std::function<bool(const Tensor &)> &movable,
+                            const std::function<bool(const Tensor &)> &viewable)
+        {
+            std::unordered_map<TensorObj *, std::pair<Tensor, size_t>> ret;
+            for (auto &op : ops)
+            {
+                if (op->getOpType() != OpType::Concat)
+                    continue;
+                auto output = op->getOutput();
+                auto dims = output->getDims();
+                int dim = as<ConcatObj>(op)->getDim();
+                if (!movable(output) ||
+                    std::any_of(dims.begin(), dims.begin() + dim,
+                                [](int d) { return d != 1; }))
+                    continue;
+                size_t offset = 0;
+                for (auto &input : op->getInputs())
+                {
+                    if (movable(input) && input->getTargets().size() == 1 &&
+                        !findAlias(input, viewable).owner &&
+                        !ret.count(input.get()))
+                        ret[input.get()] = {output, offset};
+                    offset += input->getBytes();
+                }
+            }
+            return ret;
+        }
+    } // namespace
 
     void GraphObj::dataMalloc()
     {
         // topological sorting first
-        IT_ASSERT(topo_sort() == true);
+        IT_ASSERT(topo_sort() == true, cycleReport());
+        checkExternalBytes();
 
         // =================================== 作业 ===================================
         // TODO：利用 allocator 给计算图分配内存
         // HINT: 获取分配好的内存指针后，可以调用 tensor 的 setDataBlob 函数给 tensor 绑定内存
         // =================================== 作业 ===================================
 
-        // Track reference counts for each tensor
-        std::unordered_map<Tensor, int> refCounts;
+        weightMalloc();
+
+        // Weights and caller-owned buffers are excluded: only graph inputs and
+        // intermediate tensors are planned in the activation arena.
+        auto inArena = [](const Tensor &tensor)
+        { return tensor && !tensor->isWeight() && !tensor->isExternal(); };
+        int numOps = ops.size();
+        vector<Lifetime> lifetimes;
+        // lifetime of the block every arena tensor is placed in, and its byte
+        // offset in that block
+        std::unordered_map<TensorObj *, std::pair<size_t, size_t>> placeOf;
+        auto addLifetime = [&](const Tensor &tensor, int step)
+        {
+            placeOf[tensor.get()] = {lifetimes.size(), 0};
+            lifetimes.push_back({tensor, step, numOps, {step}});
+        };
+        // Transposes and split pieces read only by kernels that take strided
+        // inputs are not computed but viewed in the memory of their input.
+        auto viewable = [&](const Tensor &tensor)
+        {
+            auto targets = tensor->getTargets();
+            return !isOutput(tensor) && !targets.empty() &&
+                   std::all_of(targets.begin(), targets.end(), readsStrided);
+        };
+        // Concat inputs are produced into their slice of the concat output,
+        // whose block then starts with the first of them.
+        auto concatSlots = inPlaceConcatInputs(
+            ops,
+            [&](const Tensor &tensor)
+            { return inArena(tensor) && !isOutput(tensor); },
+            viewable);
+        // strides are set as tensors are placed, so views of views compose
         for (auto &tensor : tensors)
+            tensor->setStrides({});
+        std::function<void(const Tensor &, int)> place =
+            [&](const Tensor &tensor, int step)
         {
-            // 图输入tensor（没有source）至少有1个引用，确保它们被分配内存
-            refCounts[tensor] = tensor->getSource() ? 0 : 1;
-        }
+            if (placeOf.count(tensor.get()))
+                return;
+            auto [owner, offset, strides] = findAlias(tensor, viewable);
+            if (auto it = concatSlots.find(tensor.get());
+                it != concatSlots.end())
+            {
+                std::tie(owner, offset) = it->second;
+                place(owner, step);
+            }
+            if (!owner)
+            {
+                addLifetime(tensor, step);
+                return;
+            }
+            tensor->setStrides(strides);
+            auto ownerPlace = placeOf.at(owner.get());
+            ownerPlace.second += offset;
+            placeOf[tensor.get()] = ownerPlace;
+            lifetimes[ownerPlace.first].aliases.emplace_back(
+                tensor, ownerPlace.second);
+        };
 
-        // Count how many operators use each tensor as input
-        for (auto &op : ops)
+        // Graph inputs are filled before run(), so they must be live from the
+        // first operator on.
+        for (auto &tensor : tensors)
         {
-            for (auto &input : op->getInputs())
+            if (!tensor->getSource() && inArena(tensor))
+            {
+                place(tensor, -1);
+            }
+        }
+        for (int step = 0; step < numOps; ++step)
+        {
+            for (auto &output : ops[step]->getOutputs())
+            {
+                if (inArena(output))
+                    place(output, step);
+            }
+        }
+        for (int step = 0; step < numOps; ++step)
+        {
+            for (auto &input : ops[step]->getInputs())
             {
-                if (input)
+                if (inArena(input))
                 {
-                    refCounts[input]++;
+                    auto &accesses =
+                        lifetimes[placeOf.at(input.get()).first].accesses;
+                    if (accesses.back() != step)
+                        accesses.emplace_back(step);
                 }
             }
         }
+        // a block is freed after the last reader of the tensors in it, graph
+        // outputs never are
+        vector<bool> holdsOutput(lifetimes.size(), false);
+        for (auto &output : getOutputs())
+            if (auto it = placeOf.find(output.get()); it != placeOf.end())
+                holdsOutput[it->second.first] = true;
+        for (size_t i = 0; i < lifetimes.size(); ++i)
+        {
+            if (holdsOutput[i])
+                lifetimes[i].accesses.emplace_back(numOps);
+            lifetimes[i].end = lifetimes[i].accesses.back();
+        }
+
+        // Planning starts over on every call, so dataMalloc() can be called
+        // again after shape_infer() changed the shapes. Under a memory budget
+        // the tensors idle for longest at the fullest step are spilled until
+        // the arena fits.
+        planArena(lifetimes, numOps);
+        while (memoryBudget > 0 && memoryPlan.stats.peak > memoryBudget)
+        {
+            IT_ASSERT(spillLongestIdle(lifetimes, numOps, allocator),
+                      "Cannot fit the activations in " +
+                          std::to_string(memoryBudget) + " bytes");
+            planArena(lifetimes, numOps);
+        }
 
-        // Track allocated memory offsets and sizes for each tensor
-        std::unordered_map<Tensor, std::pair<size_t, size_t>> tensorAlloc; // tensor -> (offset, size)
+        // Get the actual memory pointer and create Blob objects for each tensor
+        char *basePtr = static_cast<char *>(allocator.getPtr());
+        if (spillFile)
+            spillFile->reset();
+        for (auto &lifetime : lifetimes)
+        {
+            void *tensorPtr = basePtr + lifetime.offset;
+            lifetime.tensor->setDataBlob(make_ref<BlobObj>(runtime, tensorPtr));
+            for (auto &[alias, offset] : lifetime.aliases)
+                alias->setDataBlob(make_ref<BlobObj>(
+                    runtime, static_cast<char *>(tensorPtr) + offset));
+            if (lifetime.spilled())
+                spillFile->add(lifetime.tensor, tensorPtr, lifetime.spillAfter,
+                               basePtr + lifetime.reloadOffset,
+                               lifetime.reloadAt);
+        }
+        if (spillFile)
+            spillFile->mapFile();
 
-        // Process operators in topological order
-        for (auto &op : ops)
+        memoryPlan.stats = allocator.getStats();
+        memoryPlan.weightBytes = weightStore->getBytes();
+    }
+
+    void GraphObj::planArena(vector<Lifetime> &lifetimes, int numOps)
+    {
+        // blocks allocated and freed at every step, from -1 (before the first
+        // operator) to numOps (after the last one); second is true for the
+        // block a spilled tensor is reloaded into
+        vector<vector<std::pair<size_t, bool>>> allocs(numOps + 2),
+            frees(numOps + 2);
+        for (size_t i = 0; i < lifetimes.size(); ++i)
         {
-            // Allocate memory for input tensors if needed (first time used)
-            for (auto &input : op->getInputs())
+            auto &l = lifetimes[i];
+            allocs[l.start + 1].emplace_back(i, false);
+            if (l.spilled())
             {
-                if (input)
-                {
-                    // If reference count > 0 and not yet allocated, allocate now
-                    if (refCounts[input] > 0 && tensorAlloc.find(input) == tensorAlloc.end())
-                    {
-                        size_t size = input->getBytes();
-                        size_t offset = allocator.alloc(size);
-                        tensorAlloc[input] = std::make_pair(offset, size);
-                    }
-                }
+                frees[l.spillAfter + 1].emplace_back(i, false);
+                allocs[l.reloadAt + 1].emplace_back(i, true);
             }
+            frees[l.end + 1].emplace_back(i, l.spilled());
+        }
 
-            // Free input tensors when their reference count becomes zero
-            for (auto &input : op->getInputs())
+        allocator.reset();
+        memoryPlan = MemoryPlan();
+        std::map<std::pair<size_t, bool>, size_t> entryOf;
+        for (int step = -1; step <= numOps; ++step)
+        {
+            // Allocate outputs while the inputs are still live, so that an
+            // operator never writes over the tensors it reads
+            for (auto &block : allocs[step + 1])
             {
-                if (input)
-                {
-                    refCounts[input]--;
-                    if (refCounts[input] == 0)
-                    {
-                        auto it = tensorAlloc.find(input);
-                        if (it != tensorAlloc.end())
-                        {
-                            allocator.free(it->second.first, it->second.second);
-                        }
-                    }
-                }
+                auto &l = lifetimes[block.first];
+                size_t size = l.tensor->getBytes();
+                size_t offset = allocator.alloc(size);
+                (block.second ? l.reloadOffset : l.offset) = offset;
+                entryOf[block] = memoryPlan.entries.size();
+                memoryPlan.entries.push_back({l.tensor->getGuid(),
+                                              l.tensor->getFuid(), offset, size,
+                                              step, numOps});
+            }
+            if (step == numOps)
+                break;
+            for (auto &block : frees[step + 1])
+            {
+                auto &entry = memoryPlan.entries[entryOf[block]];
+                allocator.free(entry.offset, entry.bytes);
+                entry.freeStep = step;
             }
+        }
+        memoryPlan.stats = allocator.getStats();
+    }
 
-            // Allocate memory for output tensors
-            for (auto &output : op->getOutputs())
+    void GraphObj::checkExternalBytes() const
+    {
+        for (auto &tensor : getTensors())
+            IT_ASSERT(!tensor->isExternal() ||
+                          tensor->getBytes() <= tensor->externalBytes,
+                      "Tensor " + std::to_string(tensor->getGuid()) +
+                          " grew to " + std::to_string(tensor->getBytes()) +
+                          " bytes, past its bound buffer of " +
+                          std::to_string(tensor->externalBytes) + " bytes");
+    }
+
+    void GraphObj::invalidatePlan()
+    {
+        compact();
+        planCache.clear();
+        memoryPlan = MemoryPlan();
+        if (spillFile)
+            spillFile->reset();
+        // the arena offsets were planned for the lifetimes of the old order
+        for (auto &tensor : tensors)
+        {
+            if (tensor->isWeight() || tensor->isExternal())
+                continue;
+            tensor->setDataBlob(nullptr);
+            tensor->setStrides({});
+        }
+    }
+
+    void GraphObj::setMemoryBudget(size_t bytes, const string &spillDir)
+    {
+        memoryBudget = bytes;
+        spillFile = bytes > 0 ? make_ref<SpillFile>(spillDir) : nullptr;
+    }
+
+    void GraphObj::prepareOp(size_t step)
+    {
+        if (!spillFile || spillFile->empty())
+            return;
+        if (step == 0)
+            spillFile->rewind();
+        spillFile->beforeStep(step);
+    }
+
+    void GraphObj::finishOp(size_t step)
+    {
+        if (!spillFile || spillFile->empty())
+            return;
+        spillFile->afterStep(step);
+        // bring spilled graph outputs back after the last operator
+        if (step + 1 == ops.size())
+            spillFile->beforeStep(step + 1);
+    }
+
+    void GraphObj::setInputShapes(const vector<Shape> &shapes)
+    {
+        compact();
+        TensorVec inputs;
+        for (auto &tensor : getInputs())
+            if (!tensor->isWeight())
+                inputs.emplace_back(tensor);
+        IT_ASSERT(inputs.size() == shapes.size());
+
+        // spill schedules are not cached: under a memory budget every call
+        // plans from scratch. Bound inputs are not bucketed, their buffers
+        // only hold the shape given.
+        auto key = planCache.getKey(shapes);
+        for (size_t i = 0; i < inputs.size(); ++i)
+            if (inputs[i]->isExternal())
+                key[i] = shapes[i];
+        if (auto plan = memoryBudget > 0 ? nullptr : planCache.find(key))
+        {
+            IT_ASSERT(plan->shapes.size() == tensors.size());
+            void *basePtr = allocator.getPtr(plan->memoryPlan.stats.peak);
+            for (size_t i = 0; i < tensors.size(); ++i)
             {
-                if (output)
-                {
-                    size_t size = output->getBytes();
-                    size_t offset = allocator.alloc(size);
-                    tensorAlloc[output] = std::make_pair(offset, size);
-                }
+                tensors[i]->setShape(plan->shapes[i]);
+                tensors[i]->setStrides(plan->strides[i]);
+                // tensors bound after the plan was cached stay with their
+                // caller's buffer
+                if (plan->offsets[i] != PlanCache::npos &&
+                    !tensors[i]->isExternal())
+                    tensors[i]->setDataBlob(make_ref<BlobObj>(
+                        runtime, static_cast<char *>(basePtr) + plan->offsets[i]));
             }
+            checkExternalBytes();
+            memoryPlan = plan->memoryPlan;
+            memoryPlan.stats.arenaSize = allocator.getStats().arenaSize;
+            return;
         }
 
-        // Get the actual memory pointer and create Blob objects for each tensor
-        void *basePtr = allocator.getPtr();
-        for (auto &p : tensorAlloc)
+        // only the operators downstream of a resized input are inferred,
+        // and the arena is kept when no shape changed
+        TensorVec resized;
+        for (size_t i = 0; i < inputs.size(); ++i)
+        {
+            if (inputs[i]->getDims() == key[i])
+                continue;
+            inputs[i]->setShape(key[i]);
+            resized.emplace_back(inputs[i]);
+        }
+        bool planned = std::all_of(tensors.begin(), tensors.end(),
+                                   [](const Tensor &tensor)
+                                   { return tensor->hasData(); });
+        if (!shape_infer(resized).empty() || !resized.empty() || !planned)
+            dataMalloc();
+        if (memoryBudget > 0)
+            return;
+
+        // offsets are taken from the bound pointers, which also covers the
+        // tensors sharing the block of another one
+        PlanCache::Plan plan;
+        auto basePtr = static_cast<char *>(allocator.getPtr());
+        for (auto &tensor : tensors)
+        {
+            plan.shapes.emplace_back(tensor->getDims());
+            plan.strides.emplace_back(
+                tensor->isContiguous() ? vector<size_t>{}
+                                       : tensor->getStrides());
+            bool inArena = !tensor->isWeight() && !tensor->isExternal();
+            plan.offsets.emplace_back(
+                inArena ? tensor->getRawDataPtr<char *>() - basePtr
+                        : PlanCache::npos);
+        }
+        plan.memoryPlan = memoryPlan;
+        planCache.insert(std::move(key), std::move(plan));
+    }
+
+    void GraphObj::weightMalloc()
+    {
+        compact();
+        TensorVec pending;
+        for (auto &tensor : tensors)
+        {
+            if (tensor->isWeight() && !tensor->hasData())
+            {
+                pending.emplace_back(tensor);
+            }
+        }
+
+        // Slots that already exist (e.g. in a store shared with another
+        // instance of the same model) are bound in order, the rest are
+        // reserved and backed by a single new region.
+        vector<size_t> slots;
+        for (auto &tensor : pending)
+        {
+            size_t slot = boundWeights++;
+            if (slot < weightStore->numSlots())
+            {
+                IT_ASSERT(weightStore->getSlotBytes(slot) == tensor->getBytes(),
+                          "Weight store slot " + std::to_string(slot) +
+                              " does not match " + tensor->toString());
+            }
+            else
+            {
+                IT_ASSERT(weightStore->reserve(tensor->getBytes()) == slot);
+            }
+            slots.emplace_back(slot);
+        }
+        weightStore->materialize();
+
+        for (size_t i = 0; i < pending.size(); ++i)
         {
-            Tensor tensor = p.first;
-            void *tensorPtr = static_cast<char *>(basePtr) + p.second.first;
-            Blob blob = make_ref<BlobObj>(runtime, tensorPtr);
-            tensor->setDataBlob(blob);
+            pending[i]->setDataBlob(
+                make_ref<BlobObj>(runtime, weightStore->getPtr(slots[i])));
         }
+    }
+
+    void GraphObj::bindInput(const Tensor &tensor, void *ptr, size_t bytes)
+    {
+        IT_ASSERT(!tensor->getSource(),
+                  "Tensor " + std::to_string(tensor->getGuid()) +
+                      " is not a graph input");
+        bindExternal(tensor, ptr, bytes);
+    }
+
+    void GraphObj::bindOutput(const Tensor &tensor, void *ptr, size_t bytes)
+    {
+        IT_ASSERT(isOutput(tensor),
+                  "Tensor " + std::to_string(tensor->getGuid()) +
+                      " is not a graph output");
+        bindExternal(tensor, ptr, bytes);
+    }
 
-        allocator.info();
+    void GraphObj::bindExternal(const Tensor &tensor, void *ptr, size_t bytes)
+    {
+        IT_ASSERT(hasTensor(tensor));
+        IT_ASSERT(!tensor->isWeight(), "Weights live in the weight store");
+        IT_ASSERT(ptr != nullptr);
+        IT_ASSERT(bytes >= tensor->getBytes(),
+                  "Buffer of " + std::to_string(bytes) + " bytes is too small for " +
+                      std::to_string(tensor->getBytes()) + " bytes");
+        IT_ASSERT(reinterpret_cast<uintptr_t>(ptr) %
+                          tensor->getDType().getSize() ==
+                      0,
+                  "Buffer is not aligned to " + tensor->getDType().toString());
+        tensor->external = true;
+        tensor->externalBytes = bytes;
+        tensor->setDataBlob(make_ref<BlobObj>(runtime, ptr));
     }
 
     Tensor GraphObj::addTensor(Shape dim, DataType dtype)
     {
-        return tensors.emplace_back(make_ref<TensorObj>(dim, dtype, runtime));
+        planCache.clear();
+        auto tensor = make_ref<TensorObj>(dim, dtype, runtime);
+        tensorSlots[tensor->getGuid()] = tensors.size();
+        fuidSlots[tensor->getFuid()] = tensors.size();
+        return tensors.emplace_back(tensor);
     }
 
     Tensor GraphObj::addTensor(const Tensor &tensor)
@@ -484,6 +1575,9 @@ namespace infini
                   std::string("Tensor runtime mismatch: cannot add a tenosr in ") +
                       tensor->getRuntime()->toString() + " to " +
                       runtime->toString());
+        planCache.clear();
+        tensorSlots[tensor->getGuid()] = tensors.size();
+        fuidSlots[tensor->getFuid()] = tensors.size();
         tensors.emplace_back(tensor);
         return tensor;
     }
@@ -501,36 +1595,35 @@ namespace infini
     // "predecessors" and "successors" of an operator of "ops" must be in "ops".
     bool GraphObj::checkValid() const
     {
+        compact();
         for (auto tensor : tensors)
         {
             IT_ASSERT(!(tensor->getTargets().size() == 0 &&
                         nullptr == tensor->getSource()));
             for (auto op : tensor->getTargets())
             {
-                IT_ASSERT(std::find(ops.begin(), ops.end(), op) != ops.end());
+                IT_ASSERT(hasOperator(op));
             }
             auto op = tensor->getSource();
-            IT_ASSERT(!(op && std::find(ops.begin(), ops.end(), op) == ops.end()));
+            IT_ASSERT(!(op && !hasOperator(op)));
         }
         for (auto op : ops)
         {
             for (auto tensor : op->getInputs())
             {
-                IT_ASSERT(std::find(tensors.begin(), tensors.end(), tensor) !=
-                          tensors.end());
+                IT_ASSERT(hasTensor(tensor));
             }
             for (auto tensor : op->getOutputs())
             {
-                IT_ASSERT(std::find(tensors.begin(), tensors.end(), tensor) !=
-                          tensors.end());
+                IT_ASSERT(hasTensor(tensor));
             }
             for (auto pre : op->getPredecessors())
             {
-                IT_ASSERT(std::find(ops.begin(), ops.end(), pre) != ops.end());
+                IT_ASSERT(hasOperator(pre));
             }
             for (auto suc : op->getSuccessors())
             {
-                IT_ASSERT(std::find(ops.begin(), ops.end(), suc) != ops.end());
+                IT_ASSERT(hasOperator(suc));
             }
         }
         std::set<UidBaseType> s;
@@ -0,0 +1,60 @@
+#include "core/memory_plan.h"
+#include <fstream>
+
+namespace infini
+{
+string MemoryPlan::toJson() const
+{
+    std::ostringstream oss;
+    oss << "{\n";
+    oss << "  \"arena_size\": " << stats.arenaSize << ",\n";
+    oss << "  \"peak\": " << stats.peak << ",\n";
+    oss << "  \"max_used\": " << stats.maxUsed << ",\n";
+    oss << "  \"requested\": " << stats.requested << ",\n";
+    oss << "  \"bytes_saved\": " << stats.bytesSaved() << ",\n";
+    oss << "  \"weight_bytes\": " << weightBytes << ",\n";
+    oss << "  \"free_blocks\": " << stats.numFreeBlocks << ",\n";
+    oss << "  \"free_bytes\": " << stats.freeBytes << ",\n";
+    oss << "  \"largest_free_block\": " << stats.largestFreeBlock << ",\n";
+    oss << "  \"fragmentation\": " << stats.fragmentation() << ",\n";
+    oss << "  \"free_block_histogram\": {";
+    for (auto it = stats.freeBlockHistogram.begin();
+         it != stats.freeBlockHistogram.end(); ++it)
+    {
+        if (it != stats.freeBlockHistogram.begin())
+            oss << ", ";
+        oss << "\"" << it->first << "\": " << it->second;
+    }
+    oss << "},\n";
+    oss << "  \"tensors\": [";
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        auto &e = entries[i];
+        oss << (i ? ",\n" : "\n") << "    {\"guid\": " << e.guid
+            << ", \"fuid\": " << e.fuid << ", \"offset\": " << e.offset
+            << ", \"bytes\": " << e.bytes << ", \"alloc_step\": " << e.allocStep
+            << ", \"free_step\": " << e.freeStep << "}";
+    }
+    oss << (entries.empty() ? "]\n" : "\n  ]\n");
+    oss << "}\n";
+    return oss.str();
+}
+
+string MemoryPlan::toCsv() const
+{
+    std::ostringstream oss;
+    oss << "guid,fuid,offset,bytes,alloc_step,free_step\n";
+    for (auto &e : entries)
+        oss << e.guid << "," << e.fuid << "," << e.offset << "," << e.bytes
+            << "," << e.allocStep << "," << e.freeStep << "\n";
+    return oss.str();
+}
+
+void MemoryPlan::dump(const string &path) const
+{
+    std::ofstream file(path, std::ios::trunc);
+    IT_ASSERT(file.good(), "Cannot open " + path);
+    bool csv = path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+    file << (csv ? toCsv() : toJson());
+}
+} // namespace infini
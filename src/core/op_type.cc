@@ -18,9 +18,12 @@ namespace infini
             CASE(Cast);
             CASE(Clip);
             CASE(Relu);
+            CASE(Reshape);
             CASE(Transpose);
             CASE(Concat);
             CASE(MatMul);
+            CASE(FusedElementWise);
+            CASE(Split);
 
         default:
             return "Unknown";
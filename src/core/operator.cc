@@ -1,5 +1,6 @@
 #include "core/operator.h"
 #include "core/graph.h"
+#include <cstring>
 
 namespace infini
 {
@@ -82,4 +83,14 @@ namespace infini
         return inferDataType(inputs);
     }
 
+    void OperatorObj::appendOptionalFloat(vector<int> &attrs,
+                                          optional<float> value)
+    {
+        int bits = 0;
+        if (value)
+            std::memcpy(&bits, &*value, sizeof(bits));
+        attrs.emplace_back(value.has_value());
+        attrs.emplace_back(bits);
+    }
+
 } // namespace infini
@@ -0,0 +1,112 @@
+#include "core/pass_manager.h"
+#include <algorithm>
+#include <chrono>
+
+namespace infini
+{
+string PassStats::toString() const
+{
+    std::ostringstream oss;
+    oss << name << ": " << time << " ms, ops " << opsBefore << " -> "
+        << opsAfter << ", tensors " << tensorsBefore << " -> " << tensorsAfter
+        << ", peak " << peakBefore << " -> " << peakAfter;
+    return oss.str();
+}
+
+PassManager PassManager::standard()
+{
+    PassManager pm;
+    pm.addPass("optimize", [](GraphObj &g) { g.optimize(); });
+    pm.addPass("dce", [](GraphObj &g) { g.eliminate_dead_code(); });
+    pm.addPass("cse",
+               [](GraphObj &g) { g.eliminate_common_subexpressions(); });
+    pm.addPass("fuse_sibling_matmuls",
+               [](GraphObj &g) { g.fuse_sibling_matmuls(); });
+    pm.addPass("fold_constants", [](GraphObj &g) { g.fold_constants(); });
+    pm.addPass("prepack_weights", [](GraphObj &g) { g.prepack_weights(); });
+    pm.addPass("fuse_element_wise",
+               [](GraphObj &g) { g.fuse_element_wise(); });
+    pm.addPass("shape_infer", [](GraphObj &g) { g.shape_infer(); });
+    pm.addPass("topo_sort", [](GraphObj &g)
+               { IT_ASSERT(g.topo_sort() == true, g.cycleReport()); });
+    pm.addPass(
+        "memory_aware_sort", [](GraphObj &g) { g.memory_aware_sort(); },
+        false);
+    pm.addPass("data_malloc", [](GraphObj &g) { g.dataMalloc(); });
+    return pm;
+}
+
+size_t PassManager::indexOf(const string &name) const
+{
+    auto it = std::find_if(passes.begin(), passes.end(),
+                           [&](const Pass &pass) { return pass.name == name; });
+    IT_ASSERT(it != passes.end(), "No pass named " + name);
+    return it - passes.begin();
+}
+
+void PassManager::addPass(const string &name, PassFunc func, bool enabled)
+{
+    for (auto &pass : passes)
+        IT_ASSERT(pass.name != name, "Duplicate pass " + name);
+    passes.push_back({name, std::move(func), enabled});
+}
+
+void PassManager::setOrder(const vector<string> &names)
+{
+    IT_ASSERT(names.size() == passes.size(),
+              "The order must list every pass once");
+    vector<Pass> ordered;
+    for (auto &name : names)
+    {
+        for (auto &pass : ordered)
+            IT_ASSERT(pass.name != name, "Pass " + name + " listed twice");
+        ordered.emplace_back(passes[indexOf(name)]);
+    }
+    passes = std::move(ordered);
+}
+
+vector<string> PassManager::getOrder() const
+{
+    vector<string> names;
+    for (auto &pass : passes)
+        names.emplace_back(pass.name);
+    return names;
+}
+
+void PassManager::run(GraphObj &graph)
+{
+    using Clock = std::chrono::steady_clock;
+    stats.clear();
+    for (auto &pass : passes)
+    {
+        if (!pass.enabled)
+            continue;
+        PassStats s;
+        s.name = pass.name;
+        s.opsBefore = graph.getOperators().size();
+        s.tensorsBefore = graph.getTensors().size();
+        s.peakBefore = graph.estimatePeak();
+        auto begin = Clock::now();
+        pass.func(graph);
+        s.time = std::chrono::duration<double, std::milli>(Clock::now() - begin)
+                     .count();
+        s.opsAfter = graph.getOperators().size();
+        s.tensorsAfter = graph.getTensors().size();
+        s.peakAfter = graph.estimatePeak();
+        stats.emplace_back(std::move(s));
+    }
+}
+
+string PassManager::report() const
+{
+    std::ostringstream oss;
+    double total = 0;
+    for (auto &s : stats)
+    {
+        oss << s.toString() << "\n";
+        total += s.time;
+    }
+    oss << "total: " << total << " ms\n";
+    return oss.str();
+}
+} // namespace infini
@@ -0,0 +1,70 @@
+#include "core/plan_cache.h"
+#include <algorithm>
+
+namespace infini
+{
+void PlanCache::setBuckets(int axis, vector<ShapeElem> bounds)
+{
+    IT_ASSERT(axis >= 0);
+    std::sort(bounds.begin(), bounds.end());
+    buckets[axis] = std::move(bounds);
+    // plans keyed with the old buckets would never be hit again
+    plans.clear();
+}
+
+vector<Shape> PlanCache::getKey(const vector<Shape> &inputShapes) const
+{
+    vector<Shape> key = inputShapes;
+    for (auto &shape : key)
+    {
+        for (auto &[axis, bounds] : buckets)
+        {
+            if (axis >= (int)shape.size())
+                continue;
+            auto it = std::lower_bound(bounds.begin(), bounds.end(), shape[axis]);
+            if (it != bounds.end())
+                shape[axis] = *it;
+        }
+    }
+    return key;
+}
+
+const PlanCache::Plan *PlanCache::find(const vector<Shape> &key)
+{
+    auto it = plans.find(key);
+    if (it == plans.end())
+    {
+        misses++;
+        return nullptr;
+    }
+    hits++;
+    it->second.lastUse = ++clock;
+    return &it->second.plan;
+}
+
+void PlanCache::insert(vector<Shape> key, Plan plan)
+{
+    if (capacity > 0 && !plans.count(key))
+        evict(capacity - 1);
+    plans[std::move(key)] = {std::move(plan), ++clock};
+}
+
+void PlanCache::setCapacity(size_t n)
+{
+    capacity = n;
+    if (capacity > 0)
+        evict(capacity);
+}
+
+void PlanCache::evict(size_t limit)
+{
+    while (plans.size() > limit)
+    {
+        auto oldest = std::min_element(
+            plans.begin(), plans.end(), [](const auto &a, const auto &b)
+            { return a.second.lastUse < b.second.lastUse; });
+        plans.erase(oldest);
+        evictions++;
+    }
+}
+} // namespace infini
@@ -0,0 +1,97 @@
+#include "core/rewrite.h"
+#include <deque>
+
+namespace infini
+{
+Ref<Pattern> pattern(OpType type, vector<Ref<Pattern>> inputs,
+                     std::function<bool(const Operator &)> predicate,
+                     bool singleUse)
+{
+    return make_ref<Pattern>(
+        Pattern{type, std::move(predicate), std::move(inputs), singleUse});
+}
+
+bool GraphRewriter::match(const Pattern &pattern, const Operator &op,
+                          Match &match)
+{
+    if (op->getOpType() != pattern.type)
+        return false;
+    if (pattern.inputs.size() > op->getInputs().size())
+        return false;
+    if (pattern.predicate && !pattern.predicate(op))
+        return false;
+    match.ops.emplace_back(op);
+    for (size_t i = 0; i < pattern.inputs.size(); ++i)
+    {
+        auto &sub = pattern.inputs[i];
+        if (!sub)
+            continue;
+        auto input = op->getInputs(i);
+        auto source = input->getSource();
+        if (!source)
+            return false;
+        if (sub->singleUse && input->getTargets().size() != 1)
+            return false;
+        if (!GraphRewriter::match(*sub, source, match))
+            return false;
+    }
+    return true;
+}
+
+size_t GraphRewriter::run(GraphObj &graph)
+{
+    counts.clear();
+    std::deque<Operator> worklist;
+    std::unordered_set<Operator> queued;
+    auto push = [&](const Operator &op) {
+        if (queued.insert(op).second)
+            worklist.push_back(op);
+    };
+    for (auto &op : graph.getOperators())
+        push(op);
+
+    size_t rewrites = 0;
+    while (!worklist.empty())
+    {
+        auto op = worklist.front();
+        worklist.pop_front();
+        queued.erase(op);
+        if (!graph.hasOperator(op))
+            continue;
+        for (auto &rule : rules)
+        {
+            Match m;
+            if (!match(rule->getPattern(), op, m))
+                continue;
+            // the rewrite may erase any matched operator, so remember the
+            // operators around them to revisit
+            OpVec around;
+            for (auto &matched : m.ops)
+            {
+                around.emplace_back(matched);
+                for (auto &pred : matched->getPredecessors())
+                    around.emplace_back(pred);
+                for (auto &succ : matched->getSuccessors())
+                    around.emplace_back(succ);
+            }
+            if (!rule->apply(graph, m))
+                continue;
+            rewrites++;
+            counts[rule->getName()]++;
+            for (auto &near : around)
+            {
+                if (!graph.hasOperator(near))
+                    continue;
+                push(near);
+                // operators created by the rewrite are connected to these
+                for (auto &pred : near->getPredecessors())
+                    push(pred);
+                for (auto &succ : near->getSuccessors())
+                    push(succ);
+            }
+            break;
+        }
+    }
+    return rewrites;
+}
+} // namespace infini
@@ -0,0 +1,852 @@
+#include "core/rewrite_rules.h"
+#include "operators/concat.h"
+#include "operators/fused_element_wise.h"
+#include "operators/matmul.h"
+#include "operators/reshape.h"
+#include "operators/split.h"
+#include "operators/transpose.h"
+#include "operators/unary.h"
+
+namespace infini
+{
+namespace
+{
+bool isIdentity(const vector<int> &permute)
+{
+    for (size_t i = 0; i < permute.size(); ++i)
+        if (permute[i] != (int)i)
+            return false;
+    return true;
+}
+
+// the permutation swaps the last two dimensions and keeps the others
+bool swapsLastTwo(const vector<int> &permute)
+{
+    int rank = permute.size();
+    if (rank < 2 || permute[rank - 2] != rank - 1 ||
+        permute[rank - 1] != rank - 2)
+        return false;
+    for (int i = 0; i < rank - 2; ++i)
+        if (permute[i] != i)
+            return false;
+    return true;
+}
+
+// the permutation keeps the order of the dimensions of `dims` larger than 1,
+// so it moves no data
+bool movesOnlyOnes(const Shape &dims, const vector<int> &permute)
+{
+    int last = -1;
+    for (auto axis : permute)
+    {
+        if (dims[axis] == 1)
+            continue;
+        if (axis < last)
+            return false;
+        last = axis;
+    }
+    return true;
+}
+
+// the shape that transposes to `dims` by `permute`
+Shape unpermute(const Shape &dims, const vector<int> &permute)
+{
+    Shape ret(dims.size());
+    for (size_t i = 0; i < dims.size(); ++i)
+        ret[permute[i]] = dims[i];
+    return ret;
+}
+
+bool isSinkableUnary(OpType type)
+{
+    return type == OpType::Relu || type == OpType::Clip ||
+           type == OpType::Cast;
+}
+
+bool isElementWise(OpType type)
+{
+    return type == OpType::Add || type == OpType::Sub ||
+           type == OpType::Mul || type == OpType::Div;
+}
+
+// `tensor` can stand for its transpose by `permute` with a reshape at most,
+// also after setInputShapes()
+bool untransposable(const GraphObj &graph, const Tensor &tensor,
+                    const vector<int> &permute)
+{
+    return tensor->getRank() == permute.size() &&
+           movesOnlyOnes(unpermute(tensor->getDims(), permute), permute) &&
+           !graph.isResizable(tensor);
+}
+
+/**
+ * @brief How the inputs of an operator are untransposed to sink a transpose
+ * through it: `transposes[i]` is the transpose feeding input i, or nullptr
+ * if the input is reshaped instead.
+ */
+struct SinkPlan
+{
+    vector<int> permute;
+    OpVec transposes;
+    int numTransposes = 0;
+};
+
+// the transpose `tensor` is the only output of, if it is read once
+Ref<TransposeObj> singleUseTranspose(const Tensor &tensor)
+{
+    auto source = tensor->getSource();
+    if (!source || source->getOpType() != OpType::Transpose ||
+        tensor->getTargets().size() != 1)
+        return nullptr;
+    return as<TransposeObj>(source);
+}
+
+optional<SinkPlan> planSink(const GraphObj &graph, const Operator &op)
+{
+    SinkPlan plan;
+    for (auto &input : op->getInputs())
+        if (auto transpose = singleUseTranspose(input))
+        {
+            plan.permute = transpose->getPermute();
+            break;
+        }
+    if (plan.permute.empty())
+        return std::nullopt;
+    for (auto &input : op->getInputs())
+    {
+        auto transpose = singleUseTranspose(input);
+        if (transpose && transpose->getPermute() == plan.permute)
+        {
+            plan.transposes.emplace_back(transpose);
+            plan.numTransposes++;
+        }
+        else if (untransposable(graph, input, plan.permute))
+        {
+            plan.transposes.emplace_back(nullptr);
+        }
+        else
+        {
+            return std::nullopt;
+        }
+    }
+    return plan;
+}
+
+// a transpose by `permute` placed on `tensor` would be removed by the rules
+// run on its reader
+bool absorbs(const GraphObj &graph, const Tensor &tensor,
+             const vector<int> &permute, int depth = 8)
+{
+    auto targets = tensor->getTargets();
+    if (depth == 0 || targets.size() != 1)
+        return false;
+    auto op = targets[0];
+    auto type = op->getOpType();
+    if (type == OpType::Transpose)
+        return true;
+    // the bias and a prepacked B of a matmul are not read through a
+    // permutation
+    if (type == OpType::MatMul)
+        return op->getInputs(0) == tensor ||
+               (op->getInputs(1) == tensor && !as<MatmulObj>(op)->getPanelB());
+    if (isSinkableUnary(type))
+        return absorbs(graph, op->getOutput(), permute, depth - 1);
+    if (!isElementWise(type) && type != OpType::Concat)
+        return false;
+    // the other inputs must be untransposable as well
+    int merged = 0;
+    for (auto &input : op->getInputs())
+    {
+        if (input == tensor)
+            continue;
+        auto transpose = singleUseTranspose(input);
+        if (transpose && transpose->getPermute() == permute)
+            merged++;
+        else if (!untransposable(graph, input, permute))
+            return false;
+    }
+    return merged > 0 || absorbs(graph, op->getOutput(), permute, depth - 1);
+}
+
+/**
+ * @brief Replace `op` by `rebuild(untransposed inputs, output)` followed by a
+ * transpose to its original output.
+ */
+void sinkTranspose(
+    GraphObj &graph, const Operator &op, const SinkPlan &plan,
+    const std::function<Operator(const TensorVec &, const Tensor &)> &rebuild)
+{
+    TensorVec inputs;
+    for (size_t i = 0; i < plan.transposes.size(); ++i)
+    {
+        auto input = op->getInputs(i);
+        if (plan.transposes[i])
+        {
+            inputs.emplace_back(plan.transposes[i]->getInputs(0));
+            continue;
+        }
+        auto dims = unpermute(input->getDims(), plan.permute);
+        if (dims == input->getDims())
+        {
+            inputs.emplace_back(input);
+            continue;
+        }
+        auto reshaped = graph.addTensor(dims, input->getDType());
+        graph.addOperator(make_ref<ReshapeObj>(nullptr, input, reshaped, dims));
+        inputs.emplace_back(reshaped);
+    }
+    auto output = op->getOutput();
+    auto sunk = graph.addTensor(unpermute(output->getDims(), plan.permute),
+                                output->getDType());
+    auto newOp = rebuild(inputs, sunk);
+    graph.replaceOperator(op, make_ref<TransposeObj>(nullptr, sunk, output,
+                                                     plan.permute));
+    graph.addOperator(newOp);
+    for (auto &transpose : plan.transposes)
+        if (transpose && graph.isUnused(transpose->getOutput()))
+            graph.eraseOperator(transpose);
+}
+
+// bounds of a Relu or Clip, a Relu clamps to [0, +inf)
+std::pair<optional<float>, optional<float>> clampBounds(const Operator &op)
+{
+    if (op->getOpType() == OpType::Relu)
+        return {0.f, std::nullopt};
+    auto clip = as<ClipObj>(op);
+    return {clip->getMin(), clip->getMax()};
+}
+
+// every element of `tensor` is known at compile time to be `value`
+bool isFilledWith(const Tensor &tensor, float value)
+{
+    if (!tensor->isConstant() || !tensor->hasData())
+        return false;
+    auto check = [&](auto *ptr)
+    {
+        for (size_t i = 0; i < tensor->size(); ++i)
+            if (ptr[i] != value)
+                return false;
+        return true;
+    };
+    if (tensor->getDType() == DataType::Float32)
+        return check(tensor->getRawDataPtr<float *>());
+    if (tensor->getDType() == DataType::UInt32)
+        return check(tensor->getRawDataPtr<uint32_t *>());
+    return false;
+}
+
+// casting back restores every value
+bool isLosslessCast(CastType type)
+{
+    switch (type)
+    {
+    case CastType::Float2Float:
+    case CastType::Float162Float:
+    case CastType::BFloat162Float:
+    case CastType::Int322Int64:
+    case CastType::Int162Int32:
+    case CastType::Int162Float:
+    case CastType::Int82Int16:
+    case CastType::Int82Int32:
+    case CastType::Int82Float:
+    case CastType::Uint82Int32:
+    case CastType::Uint82Int64:
+    case CastType::Uint82Float:
+    case CastType::Uint322Int64:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Bypass `op`, which does not change the data of its input, or turn it into
+// a reshape when its output is a graph output and has to stay.
+void removeCopy(GraphObj &graph, const Operator &op, const Tensor &input)
+{
+    auto output = op->getOutput();
+    if (graph.isOutput(output))
+    {
+        // all zeros copy the input dims, so the reshape follows input shapes
+        // given by setInputShapes()
+        auto dims = input->getDims() == output->getDims()
+                        ? Shape(output->getRank(), 0)
+                        : output->getDims();
+        graph.replaceOperator(
+            op, make_ref<ReshapeObj>(nullptr, input, output, dims));
+    }
+    else
+    {
+        graph.replaceAllUses(output, input);
+        graph.eraseOperator(op);
+    }
+}
+} // namespace
+
+ComposeTransposeRule::ComposeTransposeRule()
+    : root(pattern(OpType::Transpose,
+                   {pattern(OpType::Transpose, {}, nullptr, true)}))
+{
+}
+
+bool ComposeTransposeRule::apply(GraphObj &graph, const Match &match)
+{
+    auto outer = as<TransposeObj>(match.ops[0]);
+    auto inner = as<TransposeObj>(match.ops[1]);
+    auto outerPermute = outer->getPermute();
+    auto innerPermute = inner->getPermute();
+    vector<int> permute(outerPermute.size());
+    for (size_t i = 0; i < permute.size(); ++i)
+        permute[i] = innerPermute[outerPermute[i]];
+
+    auto input = inner->getInputs(0);
+    if (isIdentity(permute))
+        removeCopy(graph, outer, input);
+    else
+        graph.replaceOperator(outer, make_ref<TransposeObj>(
+                                         nullptr, input, outer->getOutput(),
+                                         permute));
+    // a declared graph output stays
+    if (graph.isUnused(inner->getOutput()))
+        graph.eraseOperator(inner);
+    return true;
+}
+
+TransposeToReshapeRule::TransposeToReshapeRule()
+    : root(pattern(OpType::Transpose, {}, [](const Operator &op) {
+          return movesOnlyOnes(op->getInputs(0)->getDims(),
+                               as<TransposeObj>(op)->getPermute());
+      }))
+{
+}
+
+bool TransposeToReshapeRule::apply(GraphObj &graph, const Match &match)
+{
+    auto transpose = as<TransposeObj>(match.ops[0]);
+    auto input = transpose->getInputs(0);
+    if (isIdentity(transpose->getPermute()))
+        removeCopy(graph, transpose, input);
+    // a dim of 1 moved now may be larger after setInputShapes()
+    else if (graph.isResizable(input))
+        return false;
+    else
+        graph.replaceOperator(transpose,
+                              make_ref<ReshapeObj>(nullptr, input,
+                                                   transpose->getOutput(),
+                                                   transpose->getOutput()
+                                                       ->getDims()));
+    return true;
+}
+
+FoldTransposeIntoMatmulRule::FoldTransposeIntoMatmulRule(int input)
+    : input(input)
+{
+    IT_ASSERT(input == 0 || input == 1);
+    vector<Ref<Pattern>> inputs(input + 1);
+    inputs[input] = pattern(OpType::Transpose);
+    root = pattern(OpType::MatMul, inputs, [input](const Operator &op) {
+        return input == 0 || !as<MatmulObj>(op)->getPanelB();
+    });
+}
+
+bool FoldTransposeIntoMatmulRule::apply(GraphObj &graph, const Match &match)
+{
+    auto matmul = as<MatmulObj>(match.ops[0]);
+    auto transpose = as<TransposeObj>(match.ops[1]);
+    auto transposed = transpose->getOutput();
+    // replaceInput() rewires both sides of matmul(t, t), so both fold
+    for (int side : {0, 1})
+    {
+        if (matmul->getInputs(side) != transposed)
+            continue;
+        auto outer = side == 0 ? matmul->getPermA() : matmul->getPermB();
+        auto permute = transpose->getPermute();
+        if (!outer.empty())
+            for (size_t i = 0; i < permute.size(); ++i)
+                permute[i] = transpose->getPermute()[outer[i]];
+        // a swap of the last two dimensions is kept in transA/transB
+        bool swap = swapsLastTwo(permute);
+        if (swap)
+            permute.clear();
+        if (side == 0)
+        {
+            matmul->setPermA(permute);
+            matmul->setTransA(matmul->getTransA() != swap);
+        }
+        else
+        {
+            matmul->setPermB(permute);
+            matmul->setTransB(matmul->getTransB() != swap);
+        }
+    }
+    graph.replaceInput(matmul, transposed, transpose->getInputs(0));
+    // the transpose may still have other readers
+    if (graph.isUnused(transposed))
+        graph.eraseOperator(transpose);
+    return true;
+}
+
+SinkTransposeThroughUnaryRule::SinkTransposeThroughUnaryRule(OpType type)
+    : root(pattern(type, {pattern(OpType::Transpose, {}, nullptr, true)}))
+{
+    IT_ASSERT(isSinkableUnary(type));
+}
+
+bool SinkTransposeThroughUnaryRule::apply(GraphObj &graph, const Match &match)
+{
+    auto op = match.ops[0];
+    auto plan = planSink(graph, op);
+    if (!plan || !absorbs(graph, op->getOutput(), plan->permute))
+        return false;
+    sinkTranspose(graph, op, *plan,
+                  [&](const TensorVec &inputs, const Tensor &output)
+                  { return op->clone(inputs, {output}); });
+    return true;
+}
+
+SinkTransposeThroughElementWiseRule::SinkTransposeThroughElementWiseRule(
+    OpType type)
+    : root(pattern(type))
+{
+    IT_ASSERT(isElementWise(type));
+}
+
+bool SinkTransposeThroughElementWiseRule::apply(GraphObj &graph,
+                                                const Match &match)
+{
+    auto op = match.ops[0];
+    auto plan = planSink(graph, op);
+    if (!plan ||
+        (plan->numTransposes < 2 &&
+         !absorbs(graph, op->getOutput(), plan->permute)))
+        return false;
+    sinkTranspose(graph, op, *plan,
+                  [&](const TensorVec &inputs, const Tensor &output)
+                  { return op->clone(inputs, {output}); });
+    return true;
+}
+
+SinkTransposeThroughConcatRule::SinkTransposeThroughConcatRule()
+    : root(pattern(OpType::Concat))
+{
+}
+
+bool SinkTransposeThroughConcatRule::apply(GraphObj &graph, const Match &match)
+{
+    auto concat = as<ConcatObj>(match.ops[0]);
+    auto plan = planSink(graph, concat);
+    if (!plan || (plan->numTransposes < 2 &&
+                  !absorbs(graph, concat->getOutput(), plan->permute)))
+        return false;
+    int dim = plan->permute[concat->getDim()];
+    sinkTranspose(graph, concat, *plan,
+                  [&](const TensorVec &inputs, const Tensor &output)
+                  {
+                      return make_ref<ConcatObj>(nullptr, inputs, output, dim);
+                  });
+    return true;
+}
+
+FuseBiasIntoMatmulRule::FuseBiasIntoMatmulRule() : root(pattern(OpType::Add))
+{
+}
+
+bool FuseBiasIntoMatmulRule::apply(GraphObj &graph, const Match &match)
+{
+    auto add = match.ops[0];
+    for (int i = 0; i < 2; ++i)
+    {
+        auto product = add->getInputs(i), bias = add->getInputs(1 - i);
+        auto source = product->getSource();
+        if (!source || source->getOpType() != OpType::MatMul ||
+            product->getTargets().size() != 1 || graph.isOutput(product))
+            continue;
+        auto matmul = as<MatmulObj>(source);
+        // the epilogue adds the bias before the activation
+        if (matmul->getBias() || matmul->getAct() != ActType::None ||
+            !(bias->getDType() == product->getDType()))
+            continue;
+        auto dims = bias->getDims();
+        if (dims.empty() || dims.size() > product->getRank() ||
+            dims.back() != product->getDims().back() ||
+            bias->size() != (size_t)dims.back() ||
+            add->getOutput()->getDims() != product->getDims())
+            continue;
+        TensorVec inputs = matmul->getInputs();
+        inputs.emplace_back(bias);
+        graph.replaceOperator(add, matmul->clone(inputs, {add->getOutput()}));
+        graph.eraseOperator(matmul);
+        return true;
+    }
+    return false;
+}
+
+FuseActivationIntoMatmulRule::FuseActivationIntoMatmulRule(OpType type)
+    : root(pattern(type, {pattern(OpType::MatMul, {}, nullptr, true)}))
+{
+    IT_ASSERT(type == OpType::Relu || type == OpType::Clip);
+}
+
+bool FuseActivationIntoMatmulRule::apply(GraphObj &graph, const Match &match)
+{
+    auto activation = match.ops[0];
+    auto matmul = as<MatmulObj>(match.ops[1]);
+    if (matmul->getAct() != ActType::None ||
+        graph.isOutput(matmul->getOutput()))
+        return false;
+    auto fused = as<MatmulObj>(
+        matmul->clone(matmul->getInputs(), {activation->getOutput()}));
+    if (activation->getOpType() == OpType::Relu)
+        fused->setAct(ActType::Relu);
+    else
+    {
+        auto clip = as<ClipObj>(activation);
+        fused->setAct(ActType::Clip, clip->getMin(), clip->getMax());
+    }
+    graph.replaceOperator(activation, fused);
+    graph.eraseOperator(matmul);
+    return true;
+}
+
+FuseSiblingMatmulsRule::FuseSiblingMatmulsRule()
+    : root(pattern(OpType::MatMul, {}, [](const Operator &op) {
+          auto matmul = as<MatmulObj>(op);
+          return !matmul->getBias() && matmul->getPermB().empty() &&
+                 matmul->getInputs(1)->isConstant() &&
+                 matmul->getInputs(1)->hasData() &&
+                 matmul->getInputs(1)->getRank() == 2;
+      }))
+{
+}
+
+bool FuseSiblingMatmulsRule::apply(GraphObj &graph, const Match &match)
+{
+    auto first = as<MatmulObj>(match.ops[0]);
+    auto a = first->getInputs(0), b = first->getInputs(1);
+    vector<Ref<MatmulObj>> siblings;
+    for (auto &op : a->getTargets())
+    {
+        if (op->getOpType() != OpType::MatMul || op->getInputs(0) != a ||
+            !getPattern().predicate(op))
+            continue;
+        auto matmul = as<MatmulObj>(op);
+        auto other = matmul->getInputs(1);
+        if (matmul->getTransA() == first->getTransA() &&
+            matmul->getPermA() == first->getPermA() &&
+            matmul->getTransB() == first->getTransB() &&
+            matmul->getAct() == first->getAct() &&
+            matmul->getClipMin() == first->getClipMin() &&
+            matmul->getClipMax() == first->getClipMax() &&
+            other->getDims() == b->getDims() &&
+            other->getDType() == b->getDType() &&
+            std::find(siblings.begin(), siblings.end(), matmul) ==
+                siblings.end())
+            siblings.emplace_back(matmul);
+    }
+    if (siblings.size() < 2)
+        return false;
+
+    // B_i stacked along n, so one matmul computes every C_i side by side,
+    // whatever the batch of A
+    int count = siblings.size();
+    int axis = first->getTransB() ? 0 : 1;
+    TensorVec weights;
+    for (auto &matmul : siblings)
+        weights.emplace_back(matmul->getInputs(1));
+    auto stackedDims = b->getDims();
+    stackedDims[axis] *= count;
+    auto stacked = graph.addTensor(stackedDims, b->getDType());
+    graph.addOperator(make_ref<ConcatObj>(nullptr, weights, stacked, axis));
+
+    auto outDims = first->getOutput()->getDims();
+    int n = outDims.back();
+    auto productDims = outDims;
+    productDims.back() *= count;
+    auto product = graph.addTensor(productDims, first->getOutput()->getDType());
+    auto fused = make_ref<MatmulObj>(nullptr, a, stacked, product,
+                                     first->getTransA(), first->getTransB(),
+                                     first->getPermA());
+    fused->setAct(first->getAct(), first->getClipMin(), first->getClipMax());
+    graph.addOperator(fused);
+    // the split writes the original outputs, with no reshape to go stale
+    TensorVec outputs;
+    OpVec replaced;
+    for (auto &matmul : siblings)
+    {
+        outputs.emplace_back(matmul->getOutput());
+        replaced.emplace_back(matmul);
+    }
+    graph.replaceOperators(
+        replaced, make_ref<SplitObj>(nullptr, product, outputs,
+                                     outDims.size() - 1, vector<int>(count, n)));
+    return true;
+}
+
+FuseElementWiseRule::FuseElementWiseRule(OpType type) : root(pattern(type))
+{
+    IT_ASSERT(type == OpType::FusedElementWise ||
+              FusedElementWiseObj::canFuse(type));
+}
+
+bool FuseElementWiseRule::apply(GraphObj &graph, const Match &match)
+{
+    auto op = match.ops[0];
+    auto output = op->getOutput();
+    Operator producer;
+    for (auto &input : op->getInputs())
+    {
+        auto source = input->getSource();
+        if (source && (source->getOpType() == OpType::FusedElementWise ||
+                       FusedElementWiseObj::canFuse(source->getOpType())) &&
+            input->getTargets().size() == 1 && !graph.isOutput(input) &&
+            input->getDims() == output->getDims() &&
+            input->getDType() == output->getDType())
+        {
+            producer = source;
+            break;
+        }
+    }
+    if (!producer)
+        return false;
+
+    // the inputs of `op` but the fused one, then the new ones of `producer`
+    auto produced = producer->getOutput();
+    TensorVec inputs;
+    auto regOf = [&](const Tensor &tensor)
+    {
+        auto it = std::find(inputs.begin(), inputs.end(), tensor);
+        if (it == inputs.end())
+            it = inputs.insert(it, tensor);
+        return int(it - inputs.begin());
+    };
+    vector<int> opRegs, producerRegs;
+    for (auto &input : op->getInputs())
+        opRegs.emplace_back(input == produced ? -1 : regOf(input));
+    for (auto &input : producer->getInputs())
+        producerRegs.emplace_back(regOf(input));
+
+    // the producer's instructions first, then those of `op` reading its
+    // result
+    auto producerProgram = FusedElementWiseObj::programOf(producer);
+    auto opProgram = FusedElementWiseObj::programOf(op);
+    int numInputs = inputs.size();
+    int result = numInputs + producerProgram.size() - 1;
+    vector<FusedInstr> program;
+    auto remap = [&](int reg, const vector<int> &regs, int numOldInputs,
+                     int firstInstr)
+    {
+        if (reg < 0)
+            return reg;
+        if (reg >= numOldInputs)
+            return firstInstr + reg - numOldInputs;
+        // -1 marks the input the producer computes
+        return regs[reg] < 0 ? result : regs[reg];
+    };
+    for (auto instr : producerProgram)
+    {
+        instr.lhs = remap(instr.lhs, producerRegs, producerRegs.size(),
+                          numInputs);
+        instr.rhs = remap(instr.rhs, producerRegs, producerRegs.size(),
+                          numInputs);
+        program.emplace_back(instr);
+    }
+    for (auto instr : opProgram)
+    {
+        instr.lhs = remap(instr.lhs, opRegs, opRegs.size(), result + 1);
+        instr.rhs = remap(instr.rhs, opRegs, opRegs.size(), result + 1);
+        program.emplace_back(instr);
+    }
+    graph.replaceOperator(op, make_ref<FusedElementWiseObj>(
+                                  nullptr, inputs, output, program));
+    graph.eraseOperator(producer);
+    return true;
+}
+
+MergeClampsRule::MergeClampsRule(OpType outer, OpType inner)
+    : root(pattern(outer, {pattern(inner, {}, nullptr, true)}))
+{
+    for (auto type : {outer, inner})
+        IT_ASSERT(type == OpType::Relu || type == OpType::Clip);
+}
+
+bool MergeClampsRule::apply(GraphObj &graph, const Match &match)
+{
+    auto outer = match.ops[0], inner = match.ops[1];
+    if (graph.isOutput(inner->getOutput()))
+        return false;
+    auto [outerMin, outerMax] = clampBounds(outer);
+    auto [innerMin, innerMax] = clampBounds(inner);
+    auto merge = [](optional<float> a, optional<float> b, bool lower)
+    {
+        if (!a || !b)
+            return a ? a : b;
+        return optional<float>(lower ? std::max(*a, *b) : std::min(*a, *b));
+    };
+    auto min = merge(outerMin, innerMin, true);
+    auto max = merge(outerMax, innerMax, false);
+    // disjoint ranges clamp everything to one bound, which one clip does not
+    if (min && max && *min > *max)
+        return false;
+    auto input = inner->getInputs(0), output = outer->getOutput();
+    Operator merged;
+    if (min == 0.f && !max)
+        merged = make_ref<ReluObj>(nullptr, input, output);
+    else
+        merged = make_ref<ClipObj>(nullptr, input, output, min, max);
+    graph.replaceOperator(outer, merged);
+    graph.eraseOperator(inner);
+    return true;
+}
+
+RemoveIdentityRule::RemoveIdentityRule(OpType type) : root(pattern(type))
+{
+    IT_ASSERT(type == OpType::Clip || type == OpType::Cast ||
+              isElementWise(type));
+}
+
+bool RemoveIdentityRule::apply(GraphObj &graph, const Match &match)
+{
+    auto op = match.ops[0];
+    auto type = op->getOpType();
+    auto output = op->getOutput();
+    if (type == OpType::Clip)
+    {
+        auto clip = as<ClipObj>(op);
+        if (clip->getMin() || clip->getMax())
+            return false;
+        removeCopy(graph, op, op->getInputs(0));
+        return true;
+    }
+    if (type == OpType::Cast)
+    {
+        if (!(output->getDType() == op->getInputs(0)->getDType()))
+            return false;
+        removeCopy(graph, op, op->getInputs(0));
+        return true;
+    }
+    // x + 0, 0 + x, x - 0, x * 1, 1 * x and x / 1
+    bool commutative = type == OpType::Add || type == OpType::Mul;
+    float neutral = type == OpType::Add || type == OpType::Sub ? 0 : 1;
+    for (int i = 0; i < 2; ++i)
+    {
+        if (i == 0 && !commutative)
+            continue;
+        auto x = op->getInputs(1 - i), other = op->getInputs(i);
+        // x may shrink after setInputShapes() while `other` keeps its shape,
+        // unless `other` is all ones
+        auto otherDims = other->getDims();
+        bool broadcastsIntoX =
+            x->getDims() == output->getDims() &&
+            (!graph.isResizable(x) ||
+             (other->getRank() <= x->getRank() &&
+              std::all_of(otherDims.begin(), otherDims.end(),
+                          [](int d) { return d == 1; })));
+        if (broadcastsIntoX && isFilledWith(other, neutral))
+        {
+            removeCopy(graph, op, x);
+            return true;
+        }
+    }
+    return false;
+}
+
+RemoveCastRoundTripRule::RemoveCastRoundTripRule()
+    : root(pattern(OpType::Cast, {pattern(OpType::Cast)}))
+{
+}
+
+bool RemoveCastRoundTripRule::apply(GraphObj &graph, const Match &match)
+{
+    auto outer = as<CastObj>(match.ops[0]), inner = as<CastObj>(match.ops[1]);
+    auto input = inner->getInputs(0);
+    if (!isLosslessCast(inner->getType()) ||
+        !(outer->getOutput()->getDType() == input->getDType()))
+        return false;
+    removeCopy(graph, outer, input);
+    // the widened tensor may have other readers
+    if (graph.isUnused(inner->getOutput()))
+        graph.eraseOperator(inner);
+    return true;
+}
+
+PrepackMatmulWeightsRule::PrepackMatmulWeightsRule(int panel)
+    : root(pattern(OpType::MatMul, {},
+                   [panel](const Operator &op) {
+                       auto matmul = as<MatmulObj>(op);
+                       return !matmul->getPanelB() &&
+                              matmul->getInputs(1)->isConstant() &&
+                              matmul->getInputs(1)->hasData() &&
+                              matmul->getOutput()->getDims().back() % panel ==
+                                  0;
+                   })),
+      panel(panel)
+{
+    IT_ASSERT(panel > 0);
+}
+
+bool PrepackMatmulWeightsRule::apply(GraphObj &graph, const Match &match)
+{
+    auto matmul = as<MatmulObj>(match.ops[0]);
+    auto weight = matmul->getInputs(1);
+    int rank = weight->getRank();
+    auto dtype = weight->getDType();
+
+    // read B as {..., k, n}
+    vector<int> logical = matmul->getPermB();
+    if (logical.empty())
+        for (int i = 0; i < rank; ++i)
+            logical.emplace_back(i);
+    if (matmul->getTransB())
+        std::swap(logical[rank - 2], logical[rank - 1]);
+    auto dims = weight->getDims();
+    Shape logicalDims;
+    for (auto axis : logical)
+        logicalDims.emplace_back(dims[axis]);
+    auto b = weight;
+    if (!isIdentity(logical))
+    {
+        b = graph.addTensor(logicalDims, dtype);
+        graph.addOperator(make_ref<TransposeObj>(nullptr, weight, b, logical));
+    }
+
+    // {..., k, n} -> {..., k, n / panel, panel} -> {..., n / panel, k, panel}
+    int k = logicalDims[rank - 2], n = logicalDims[rank - 1];
+    Shape splitDims(logicalDims.begin(), logicalDims.end() - 1);
+    splitDims.emplace_back(n / panel);
+    splitDims.emplace_back(panel);
+    auto split = graph.addTensor(splitDims, dtype);
+    graph.addOperator(make_ref<ReshapeObj>(nullptr, b, split, splitDims));
+    vector<int> toPanels;
+    for (int i = 0; i < rank - 2; ++i)
+        toPanels.emplace_back(i);
+    toPanels.insert(toPanels.end(), {rank - 1, rank - 2, rank});
+    Shape packedDims(logicalDims.begin(), logicalDims.end() - 2);
+    packedDims.insert(packedDims.end(), {n / panel, k, panel});
+    auto packed = graph.addTensor(packedDims, dtype);
+    graph.addOperator(
+        make_ref<TransposeObj>(nullptr, split, packed, toPanels));
+
+    // every matmul reading the weight the same way shares the packed copy
+    vector<Ref<MatmulObj>> readers;
+    for (auto &op : weight->getTargets())
+    {
+        auto other = as<MatmulObj>(op);
+        if (other && other->getInputs(1) == weight &&
+            other->getTransB() == matmul->getTransB() &&
+            other->getPermB() == matmul->getPermB() &&
+            getPattern().predicate(op) &&
+            std::find(readers.begin(), readers.end(), other) == readers.end())
+            readers.emplace_back(other);
+    }
+    for (auto &reader : readers)
+    {
+        auto prepacked = make_ref<MatmulObj>(
+            nullptr, reader->getInputs(0), packed, reader->getOutput(),
+            reader->getTransA(), false, reader->getPermA(), vector<int>{},
+            reader->getBias(), panel);
+        prepacked->setAct(reader->getAct(), reader->getClipMin(),
+                          reader->getClipMax());
+        graph.replaceOperator(reader, prepacked);
+    }
+    return true;
+}
+} // namespace infini
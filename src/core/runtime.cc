@@ -8,15 +8,25 @@
 #include <memory>
 namespace infini
 {
-    void NativeCpuRuntimeObj::run(const Graph &graph) const
+    void NativeCpuRuntimeObj::run(const Graph &graph,
+                                  const TensorVec &outputs) const
     {
         const auto &kernelRegistry = KernelRegistry::getInstance();
 
-        for (auto &op : graph->getOperators())
+        auto &ops = graph->getOperators();
+        auto needed = outputs.empty() ? vector<bool>(ops.size(), true)
+                                      : graph->opsNeededFor(outputs);
+        for (size_t i = 0; i < ops.size(); ++i)
         {
+            auto &op = ops[i];
             auto kernelAttrs = KernelAttrs{device, op->getOpType().underlying()};
             Kernel *kernel = kernelRegistry.getKernel(kernelAttrs);
-            kernel->compute(op, this);
+            // skipped steps still move spilled tensors, which follow the
+            // schedule of the whole graph
+            graph->prepareOp(i);
+            if (needed[i])
+                kernel->compute(op, this);
+            graph->finishOp(i);
         }
     }
 
@@ -0,0 +1,105 @@
+#include "core/spill_file.h"
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace infini
+{
+SpillFile::SpillFile(string dir)
+    : dir(std::move(dir)), fd(-1), base(nullptr), size(0) {}
+
+SpillFile::~SpillFile()
+{
+    if (base != nullptr)
+        munmap(base, size);
+    if (fd >= 0)
+        close(fd);
+}
+
+void SpillFile::reset()
+{
+    spills.clear();
+    spillAfter.clear();
+    reloadAt.clear();
+}
+
+void SpillFile::add(const Tensor &tensor, void *home, int spillAfter,
+                    void *reload, int reloadAt)
+{
+    // keep every spill on its own pages so they can be prefetched apart
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+    size_t offset = 0;
+    if (!spills.empty())
+    {
+        auto &last = spills.back();
+        offset = (last.offset + last.bytes + pageSize - 1) / pageSize * pageSize;
+    }
+    this->spillAfter[spillAfter].emplace_back(spills.size());
+    this->reloadAt[reloadAt].emplace_back(spills.size());
+    spills.push_back({tensor, home, reload, offset, tensor->getBytes()});
+}
+
+void SpillFile::mapFile()
+{
+    size_t needed = spills.empty() ? 0 : spills.back().offset + spills.back().bytes;
+    if (needed <= size)
+        return;
+    if (base != nullptr)
+        munmap(base, size);
+    if (fd < 0)
+    {
+        // the file is unlinked right away and disappears with the process
+        string path = dir + "/infini_spill_XXXXXX";
+        fd = mkstemp(path.data());
+        IT_ASSERT(fd >= 0, "Cannot create a spill file in " + dir);
+        unlink(path.c_str());
+    }
+    IT_ASSERT(ftruncate(fd, needed) == 0, "Cannot grow the spill file");
+    base = mmap(nullptr, needed, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    IT_ASSERT(base != MAP_FAILED, "Cannot map the spill file");
+    size = needed;
+}
+
+void SpillFile::rewind()
+{
+    for (auto &spill : spills)
+        spill.tensor->setDataBlob(
+            make_ref<BlobObj>(spill.tensor->getRuntime(), spill.home));
+}
+
+void SpillFile::beforeStep(int step)
+{
+    if (auto it = reloadAt.find(step); it != reloadAt.end())
+    {
+        for (auto i : it->second)
+        {
+            auto &spill = spills[i];
+            std::memcpy(spill.reload, static_cast<char *>(base) + spill.offset,
+                        spill.bytes);
+            spill.tensor->setDataBlob(
+                make_ref<BlobObj>(spill.tensor->getRuntime(), spill.reload));
+        }
+    }
+    // read ahead what the next step reloads while this one computes
+    if (auto it = reloadAt.find(step + 1); it != reloadAt.end())
+    {
+        for (auto i : it->second)
+            madvise(static_cast<char *>(base) + spills[i].offset,
+                    spills[i].bytes, MADV_WILLNEED);
+    }
+}
+
+void SpillFile::afterStep(int step)
+{
+    if (auto it = spillAfter.find(step); it != spillAfter.end())
+    {
+        for (auto i : it->second)
+        {
+            auto &spill = spills[i];
+            std::memcpy(static_cast<char *>(base) + spill.offset, spill.home,
+                        spill.bytes);
+        }
+    }
+}
+} // namespace infini
@@ -8,7 +8,8 @@
 namespace infini {
 
     TensorObj::TensorObj(Shape shape_, DataType dtype, Runtime runtime)
-        : dim(shape_.size()), dtype(dtype), runtime(runtime), shape(std::move(shape_)),
+        : dim(shape_.size()), dtype(dtype), runtime(runtime), weight(false),
+          constant(false), external(false), externalBytes(0), shape(std::move(shape_)),
           _size(std::accumulate(shape.begin(), shape.end(), 1, std::multiplies{})) {}
 
     string TensorObj::toString() const
@@ -40,6 +41,29 @@ void TensorObj::setShape(Shape shape_) {
     size_t size = std::accumulate(shape.begin(), shape.end(), 1,
                                   [](auto acc, auto x) { return acc * x; });
     _size = size;
+    strides.clear();
+}
+
+vector<size_t> TensorObj::getStrides() const {
+    if (!strides.empty())
+        return strides;
+    vector<size_t> ret(shape.size(), 1);
+    for (int i = (int)shape.size() - 2; i >= 0; --i)
+        ret[i] = ret[i + 1] * shape[i + 1];
+    return ret;
+}
+
+void TensorObj::setStrides(vector<size_t> strides_) {
+    IT_ASSERT(strides_.empty() || strides_.size() == shape.size());
+    // dims of size 1 are never stepped over, so their stride is irrelevant
+    bool contiguous = true;
+    for (size_t i = 0, expect = 1; i < strides_.size(); ++i) {
+        size_t axis = strides_.size() - 1 - i;
+        if (shape[axis] != 1 && strides_[axis] != expect)
+            contiguous = false;
+        expect *= shape[axis];
+    }
+    strides = contiguous ? vector<size_t>{} : std::move(strides_);
 }
 
 void TensorObj::printData() const {
@@ -84,7 +108,7 @@ bool TensorObj::equalData(const Tensor &rhs, double relativeError) const {
     if (dtype == DataType(N))                                                  \
         return equalDataImpl(getRawDataPtr<DT<N>::t *>(),                      \
                              rhs->getRawDataPtr<DT<N>::t *>(), size(),         \
-                             relativeError);
+                             relativeError, rhs.get());
 
     TEST_EQUAL(0)           // fmt: new line
     else TEST_EQUAL(1)      //
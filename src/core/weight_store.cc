@@ -0,0 +1,139 @@
+#include "core/weight_store.h"
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace infini
+{
+// file layout: magic, slot count, slot sizes, then the slot data with every
+// slot starting at a multiple of the store alignment
+static constexpr uint64_t WEIGHT_FILE_MAGIC = 0x45524f5453544957; // "WITSTORE"
+
+WeightStoreObj::WeightStoreObj(Runtime runtime) : runtime(runtime)
+{
+    // align to cache line so that every weight starts on its own line
+    alignment = 64;
+}
+
+WeightStoreObj::~WeightStoreObj()
+{
+    for (auto &region : regions)
+    {
+        if (region.mapped)
+            munmap(region.ptr, region.size);
+        else
+            runtime->dealloc(region.ptr);
+    }
+}
+
+size_t WeightStoreObj::reserve(size_t bytes)
+{
+    slots.push_back({npos, 0, bytes});
+    return slots.size() - 1;
+}
+
+void WeightStoreObj::materialize()
+{
+    size_t size = 0;
+    for (auto &slot : slots)
+    {
+        if (slot.region == npos)
+        {
+            slot.region = regions.size();
+            slot.offset = size;
+            size += getAlignedSize(slot.bytes);
+        }
+    }
+    if (size == 0)
+        return;
+    regions.push_back({runtime->alloc(size), size, false});
+}
+
+void *WeightStoreObj::getPtr(size_t slot) const
+{
+    auto &s = slots.at(slot);
+    IT_ASSERT(s.region != npos, "Weight slot " + std::to_string(slot) +
+                                    " is not materialized");
+    return static_cast<char *>(regions[s.region].ptr) + s.offset;
+}
+
+bool WeightStoreObj::isReadOnly(size_t slot) const
+{
+    auto &s = slots.at(slot);
+    return s.region != npos && regions[s.region].mapped;
+}
+
+size_t WeightStoreObj::getBytes() const
+{
+    size_t bytes = 0;
+    for (auto &region : regions)
+        bytes += region.size;
+    return bytes;
+}
+
+void WeightStoreObj::save(const string &path) const
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    IT_ASSERT(file.good(), "Cannot open " + path);
+    uint64_t header[2] = {WEIGHT_FILE_MAGIC, slots.size()};
+    file.write(reinterpret_cast<const char *>(header), sizeof(header));
+    for (auto &slot : slots)
+    {
+        uint64_t bytes = slot.bytes;
+        file.write(reinterpret_cast<const char *>(&bytes), sizeof(bytes));
+    }
+    size_t pos = sizeof(header) + slots.size() * sizeof(uint64_t);
+    vector<char> padding(alignment, 0);
+    for (size_t i = 0; i < slots.size(); ++i)
+    {
+        size_t aligned = getAlignedSize(pos);
+        file.write(padding.data(), aligned - pos);
+        file.write(static_cast<const char *>(getPtr(i)), slots[i].bytes);
+        pos = aligned + slots[i].bytes;
+    }
+    IT_ASSERT(file.good(), "Failed to write " + path);
+}
+
+WeightStore WeightStoreObj::load(Runtime runtime, const string &path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    IT_ASSERT(fd >= 0, "Cannot open " + path);
+    struct stat st;
+    IT_ASSERT(fstat(fd, &st) == 0);
+    size_t size = st.st_size;
+    void *ptr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    IT_ASSERT(ptr != MAP_FAILED, "Cannot map " + path);
+
+    auto store = make_ref<WeightStoreObj>(runtime);
+    store->regions.push_back({ptr, size, true});
+
+    auto header = static_cast<const uint64_t *>(ptr);
+    IT_ASSERT(size >= 2 * sizeof(uint64_t) && header[0] == WEIGHT_FILE_MAGIC,
+              path + " is not a weight file");
+    // the sizes come from the file: compare them against what is left of it
+    // so that a corrupt header cannot overflow the bounds checks
+    size_t count = header[1];
+    IT_ASSERT(count <= size / sizeof(uint64_t) - 2, path + " is truncated");
+    size_t pos = (2 + count) * sizeof(uint64_t);
+    for (size_t i = 0; i < count; ++i)
+    {
+        size_t offset = store->getAlignedSize(pos);
+        size_t bytes = header[2 + i];
+        IT_ASSERT(offset <= size && bytes <= size - offset,
+                  path + " is truncated");
+        store->slots.push_back({0, offset, bytes});
+        pos = offset + bytes;
+    }
+    return store;
+}
+
+size_t WeightStoreObj::getAlignedSize(size_t size) const
+{
+    return (size + alignment - 1) / alignment * alignment;
+}
+} // namespace infini
@@ -1,5 +1,6 @@
 #include "operators/concat.h"
 #include "core/kernel.h"
+#include "utils/operator_utils.h"
 
 namespace infini {
 
@@ -32,11 +33,20 @@ class NaiveConcat : public CpuKernelWithoutConfig {
             auto inSize = input->size();
             auto inPtr = input->getRawDataPtr<T *>(),
                  outPtr = output->getRawDataPtr<T *>();
+            // dataMalloc() placed the input in its slice of the output
+            if (inPtr == outPtr + innerOffset && localBlockOffset == inSize &&
+                input->isContiguous())
+                continue;
+            // a strided view is read element by element through its strides
+            bool contiguous = input->isContiguous();
+            auto inStrides = input->getStrides();
 #pragma omp parallel for
             for (size_t iOffset = 0; iOffset < inSize; ++iOffset) {
                 auto oOffset = iOffset % localBlockOffset + innerOffset +
                                iOffset / localBlockOffset * blockOffset;
-                outPtr[oOffset] = inPtr[iOffset];
+                outPtr[oOffset] =
+                    inPtr[contiguous ? iOffset
+                                     : strided_offset(iOffset, iDim, inStrides)];
             }
         }
     }
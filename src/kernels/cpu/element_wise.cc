@@ -48,19 +48,17 @@ namespace infini
                       a.begin() + (rank - shapeA.size()));
             std::copy(shapeB.begin(), shapeB.end(),
                       b.begin() + (rank - shapeB.size()));
-            auto getStride = [&](const Shape &shape)
+            // the inputs may be strided views, see TensorObj::getStrides()
+            auto getStride = [&](const Tensor &tensor)
             {
-                int p = 1;
-                Shape stride(rank);
-                for (auto i = rank; i > 0; --i)
-                {
-                    stride[i - 1] = p;
-                    p = p * shape[i - 1];
-                }
+                auto strides = tensor->getStrides();
+                Shape stride(rank, 0);
+                std::copy(strides.begin(), strides.end(),
+                          stride.begin() + (rank - strides.size()));
                 return stride;
             };
-            Shape strideA = getStride(a);
-            Shape strideB = getStride(b);
+            Shape strideA = getStride(op->getInputs(0));
+            Shape strideB = getStride(op->getInputs(1));
 
             auto n = op->getOutput()->size();
             T (*_doCompute)
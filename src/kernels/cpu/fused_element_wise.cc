@@ -0,0 +1,149 @@
+#include "operators/fused_element_wise.h"
+#include "core/kernel.h"
+#include <algorithm>
+
+namespace infini
+{
+    class NativeFusedElementWise : public CpuKernelWithoutConfig
+    {
+        // Elements evaluated per step. The registers of a block stay in
+        // cache, so the memory is read and written once whatever the length
+        // of the program.
+        static constexpr size_t blockSize = 256;
+
+        template <typename T, typename F>
+        static void binary(const T *a, const T *b, T *out, size_t len, F f)
+        {
+            for (size_t i = 0; i < len; ++i)
+                out[i] = f(a[i], b[i]);
+        }
+
+        template <typename T>
+        void doCompute(const Operator &_op, const RuntimeObj *context) const
+        {
+            auto op = as<FusedElementWiseObj>(_op);
+            auto &program = op->getProgram();
+            auto outDims = op->getOutput()->getDims();
+            size_t rank = outDims.size(), n = op->getOutput()->size();
+            size_t numInputs = op->getInputs().size();
+
+            // element strides of the inputs in the output shape, 0 along
+            // broadcast dimensions
+            vector<vector<size_t>> strides;
+            vector<const T *> inPtrs;
+            for (auto &input : op->getInputs())
+            {
+                auto dims = input->getDims();
+                vector<size_t> stride(rank, 0);
+                size_t p = 1;
+                for (size_t i = dims.size(); i > 0; --i)
+                {
+                    if (dims[i - 1] != 1)
+                        stride[rank - dims.size() + i - 1] = p;
+                    p *= dims[i - 1];
+                }
+                strides.emplace_back(std::move(stride));
+                inPtrs.emplace_back(input->getRawDataPtr<T *>());
+            }
+            T *outPtr = op->getOutput()->getRawDataPtr<T *>();
+
+            vector<vector<T>> buffers(numInputs + program.size(),
+                                      vector<T>(blockSize));
+            vector<const T *> regs(buffers.size());
+            for (size_t base = 0; base < n; base += blockSize)
+            {
+                size_t len = std::min(blockSize, n - base);
+                for (size_t j = 0; j < numInputs; ++j)
+                {
+                    // full-size inputs are read in place
+                    if (op->getInputs(j)->size() == n)
+                    {
+                        regs[j] = inPtrs[j] + base;
+                        continue;
+                    }
+                    for (size_t i = 0; i < len; ++i)
+                    {
+                        size_t offset = 0;
+                        for (size_t d = rank, rest = base + i; d > 0; --d)
+                        {
+                            offset += rest % outDims[d - 1] * strides[j][d - 1];
+                            rest /= outDims[d - 1];
+                        }
+                        buffers[j][i] = inPtrs[j][offset];
+                    }
+                    regs[j] = buffers[j].data();
+                }
+                for (size_t t = 0; t < program.size(); ++t)
+                {
+                    auto &instr = program[t];
+                    size_t r = numInputs + t;
+                    // the last instruction stores straight to the output
+                    T *out = t + 1 == program.size() ? outPtr + base
+                                                     : buffers[r].data();
+                    const T *a = regs[instr.lhs];
+                    const T *b = instr.rhs >= 0 ? regs[instr.rhs] : nullptr;
+                    switch (instr.type.underlying())
+                    {
+                    case OpType::Add:
+                        binary(a, b, out, len, [](T x, T y) { return x + y; });
+                        break;
+                    case OpType::Sub:
+                        binary(a, b, out, len, [](T x, T y) { return x - y; });
+                        break;
+                    case OpType::Mul:
+                        binary(a, b, out, len, [](T x, T y) { return x * y; });
+                        break;
+                    case OpType::Div:
+                        binary(a, b, out, len,
+                               [](T x, T y) { return (T)(x / y); });
+                        break;
+                    case OpType::Relu:
+                        for (size_t i = 0; i < len; ++i)
+                            out[i] = std::max(T(0), a[i]);
+                        break;
+                    case OpType::Clip:
+                    {
+                        T lo = instr.min ? T(*instr.min) : T(0);
+                        T hi = instr.max ? T(*instr.max) : T(0);
+                        for (size_t i = 0; i < len; ++i)
+                        {
+                            T v = a[i];
+                            if (instr.min)
+                                v = std::max(v, lo);
+                            if (instr.max)
+                                v = std::min(v, hi);
+                            out[i] = v;
+                        }
+                        break;
+                    }
+                    default:
+                        IT_TODO_HALT();
+                    }
+                    regs[r] = out;
+                }
+            }
+        }
+
+        void compute(const Operator &_op,
+                     const RuntimeObj *context) const override
+        {
+#define CASE(N) \
+    case N:     \
+        doCompute<DT<N>::t>(_op, context)
+
+            int dataTypeIdx = _op->getDType().getIndex();
+            switch (dataTypeIdx)
+            {
+                CASE(1); // DataType::Float32
+                break;
+                CASE(12); // DataType::UInt32
+                break;
+            default:
+                IT_TODO_HALT();
+            }
+        }
+    };
+
+    REGISTER_KERNEL(Device::CPU, OpType::FusedElementWise,
+                    NativeFusedElementWise, "FusedElementWiseNaive_CPU");
+}; // namespace infini
@@ -0,0 +1,151 @@
+#include "operators/matmul.h"
+#include "core/kernel.h"
+#include <algorithm>
+
+namespace infini {
+
+// Element strides of `tensor`, which may be a strided view, read through
+// `permute`, with the last two swapped if `trans`, right-aligned to `rank`
+// dims. Broadcast dims get stride 0.
+inline vector<size_t> logicalStrides(const Tensor &tensor,
+                                     const vector<int> &permute, bool trans,
+                                     size_t rank, Shape &dims) {
+    auto stored = tensor->getDims();
+    size_t r = stored.size();
+    auto storedStrides = tensor->getStrides();
+
+    dims.assign(rank, 1);
+    vector<size_t> strides(rank, 0);
+    for (size_t i = 0; i < r; ++i) {
+        size_t axis = permute.empty() ? i : permute[i];
+        dims[rank - r + i] = stored[axis];
+        strides[rank - r + i] = stored[axis] == 1 ? 0 : storedStrides[axis];
+    }
+    if (trans) {
+        std::swap(dims[rank - 1], dims[rank - 2]);
+        std::swap(strides[rank - 1], strides[rank - 2]);
+    }
+    return strides;
+}
+
+class NaiveMatmul : public CpuKernelWithoutConfig {
+    template <typename T>
+    void doCompute(const Operator &_op, const RuntimeObj *context) const {
+        auto op = as<MatmulObj>(_op);
+        // Sizes come from the tensors rather than getM/N/K(), which are only
+        // updated by shape inference.
+        auto outDims = op->getOutput()->getDims();
+        size_t rank = outDims.size();
+        Shape aDims, bDims;
+        auto aStrides = logicalStrides(op->getInputs(0), op->getPermA(),
+                                       op->getTransA(), rank, aDims);
+        // a prepacked B {..., n / panel, k, panel} is walked panel by panel,
+        // only its batch strides are taken from here
+        int panel = op->getPanelB();
+        auto bStrides =
+            panel ? logicalStrides(op->getInputs(1), {}, false, rank + 1, bDims)
+                  : logicalStrides(op->getInputs(1), op->getPermB(),
+                                   op->getTransB(), rank, bDims);
+        if (panel)
+            bDims = {bDims[rank - 1], panel};
+        size_t m = outDims[rank - 2], n = outDims[rank - 1],
+               k = aDims[rank - 1];
+        IT_ASSERT(bDims[bDims.size() - 2] == (int)k);
+
+        auto aPtr = op->getInputs(0)->getRawDataPtr<T *>(),
+             bPtr = op->getInputs(1)->getRawDataPtr<T *>(),
+             cPtr = op->getOutput()->getRawDataPtr<T *>();
+        auto bias = op->getBias();
+        T *biasPtr = bias ? bias->getRawDataPtr<T *>() : nullptr;
+        // the bias may be a strided view too, its other dims are all 1
+        size_t biasStride = bias ? bias->getStrides().back() : 0;
+        auto act = op->getAct();
+        auto lo = op->getClipMin(), hi = op->getClipMax();
+        // the epilogue runs on the accumulator, so C is written once
+        auto epilogue = [&](T sum, size_t j) {
+            if (biasPtr)
+                sum += biasPtr[j * biasStride];
+            if (act == ActType::Relu)
+                sum = std::max(sum, T(0));
+            else if (act == ActType::Clip) {
+                if (lo)
+                    sum = std::max(sum, T(*lo));
+                if (hi)
+                    sum = std::min(sum, T(*hi));
+            }
+            return sum;
+        };
+        size_t batch = op->getOutput()->size() / (m * n);
+        for (size_t b = 0; b < batch; ++b) {
+            // offsets of this batch in A and B
+            size_t aOffset = 0, bOffset = 0;
+            for (int i = (int)rank - 3, rest = b; i >= 0; --i) {
+                size_t pos = rest % outDims[i];
+                rest /= outDims[i];
+                aOffset += pos * aStrides[i];
+                bOffset += pos * bStrides[i];
+            }
+            auto c = cPtr + b * m * n;
+            if (panel) {
+                multiplyPanels(aPtr + aOffset, aStrides[rank - 2],
+                               aStrides[rank - 1], bPtr + bOffset, c, m, n, k,
+                               panel, epilogue);
+                continue;
+            }
+            for (size_t i = 0; i < m; ++i)
+                for (size_t j = 0; j < n; ++j) {
+                    T sum = 0;
+                    for (size_t p = 0; p < k; ++p)
+                        sum += aPtr[aOffset + i * aStrides[rank - 2] +
+                                    p * aStrides[rank - 1]] *
+                               bPtr[bOffset + p * bStrides[rank - 2] +
+                                    j * bStrides[rank - 1]];
+                    c[i * n + j] = epilogue(sum, j);
+                }
+        }
+    }
+
+    // C = A * B for B packed in panels of `panel` columns: each row of A
+    // streams through a panel, whose k rows are contiguous
+    template <typename T, typename Epilogue>
+    static void multiplyPanels(const T *a, size_t aRow, size_t aCol,
+                               const T *b, T *c, size_t m, size_t n, size_t k,
+                               size_t panel, const Epilogue &epilogue) {
+        vector<T> acc(panel);
+        for (size_t j0 = 0; j0 < n; j0 += panel) {
+            auto bPanel = b + j0 * k;
+            for (size_t i = 0; i < m; ++i) {
+                std::fill(acc.begin(), acc.end(), T(0));
+                for (size_t p = 0; p < k; ++p) {
+                    T value = a[i * aRow + p * aCol];
+                    auto row = bPanel + p * panel;
+                    for (size_t jj = 0; jj < panel; ++jj)
+                        acc[jj] += value * row[jj];
+                }
+                for (size_t jj = 0; jj < panel; ++jj)
+                    c[i * n + j0 + jj] = epilogue(acc[jj], j0 + jj);
+            }
+        }
+    }
+
+    void compute(const Operator &_op,
+                 const RuntimeObj *context) const override {
+#define CASE(N)                                                                \
+    case N:                                                                    \
+        doCompute<DT<N>::t>(_op, context)
+
+        int dataTypeIdx = _op->getDType().getIndex();
+        switch (dataTypeIdx) {
+            CASE(1); // DataType::Float32
+            break;
+            CASE(12); // DataType::UInt32
+            break;
+        default:
+            IT_TODO_HALT();
+        }
+    }
+};
+
+REGISTER_KERNEL(Device::CPU, OpType::MatMul, NaiveMatmul, "MatmulNaive_CPU");
+
+} // namespace infini
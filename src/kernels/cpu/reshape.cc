@@ -0,0 +1,21 @@
+#include "operators/reshape.h"
+#include "core/kernel.h"
+#include <cstring>
+
+namespace infini {
+
+class NaiveReshape : public CpuKernelWithoutConfig {
+    void compute(const Operator &_op,
+                 const RuntimeObj *context) const override {
+        auto input = _op->getInputs(0), output = _op->getOutput();
+        auto inPtr = input->getRawDataPtr<void *>(),
+             outPtr = output->getRawDataPtr<void *>();
+        // nothing to do when the output shares the memory of the input
+        if (inPtr != outPtr)
+            std::memcpy(outPtr, inPtr, input->getBytes());
+    }
+};
+
+REGISTER_KERNEL(Device::CPU, OpType::Reshape, NaiveReshape, "ReshapeNaive_CPU");
+
+} // namespace infini
@@ -0,0 +1,57 @@
+#include "operators/split.h"
+#include "core/kernel.h"
+
+namespace infini {
+
+class NaiveSplit : public CpuKernelWithoutConfig {
+    template <typename T>
+    void doCompute(const Operator &_op, const RuntimeObj *context) const {
+        auto op = as<SplitObj>(_op);
+        auto input = op->getInputs(0);
+        auto dim = op->getDim();
+        const auto &inDim = input->getDims();
+        size_t blockOffsetInner = 1;
+        for (size_t i = inDim.size() - 1; i > (size_t)dim; --i)
+            blockOffsetInner *= inDim[i];
+        size_t blockOffset = inDim[dim] * blockOffsetInner;
+        auto inPtr = input->getRawDataPtr<T *>();
+        size_t dimOffset = 0;
+        for (auto &output : op->getOutputs()) {
+            auto outPtr = output->getRawDataPtr<T *>();
+            size_t localBlockOffset = output->getDims()[dim] * blockOffsetInner;
+            auto innerOffset = blockOffsetInner * dimOffset;
+            dimOffset += output->getDims()[dim];
+            // a piece placed in the memory of the input, as a contiguous
+            // block or as a strided view, is already there
+            if (outPtr == inPtr + innerOffset)
+                continue;
+            auto outSize = output->size();
+            for (size_t oOffset = 0; oOffset < outSize; ++oOffset) {
+                auto iOffset = oOffset % localBlockOffset + innerOffset +
+                               oOffset / localBlockOffset * blockOffset;
+                outPtr[oOffset] = inPtr[iOffset];
+            }
+        }
+    }
+
+    void compute(const Operator &_op,
+                 const RuntimeObj *context) const override {
+#define CASE(N)                                                                \
+    case N:                                                                    \
+        doCompute<DT<N>::t>(_op, context)
+
+        int dataTypeIdx = _op->getDType().getIndex();
+        switch (dataTypeIdx) {
+            CASE(1); // DataType::Float32
+            break;
+            CASE(12); // DataType::UInt32
+            break;
+        default:
+            IT_TODO_HALT();
+        }
+    }
+};
+
+REGISTER_KERNEL(Device::CPU, OpType::Split, NaiveSplit, "SplitNaive_CPU");
+
+} // namespace infini
@@ -25,14 +25,20 @@ class NaiveTranspose : public CpuKernelWithoutConfig {
         size_t inSize = inputs[0]->size();
         auto inPtr = inputs[0]->getRawDataPtr<T *>(),
              outPtr = outputs[0]->getRawDataPtr<T *>();
+        // dataMalloc() made the output a strided view of the input
+        if (outPtr == inPtr)
+            return;
+        auto inStrides = inputs[0]->getStrides();
         // #pragma omp parallel for
         for (size_t inIdx = 0; inIdx < inSize; ++inIdx) {
             auto posInput = idx2Pos(inDim, inIdx);
             int outIdx = 0;
+            size_t inOffset = 0;
             for (size_t j = 0, jEnd = perm.size(); j < jEnd; ++j) {
                 outIdx = outIdx * inDim[perm[j]] + posInput[perm[j]];
+                inOffset += posInput[j] * inStrides[j];
             }
-            outPtr[outIdx] = inPtr[inIdx];
+            outPtr[outIdx] = inPtr[inOffset];
         }
     }
 
@@ -1,5 +1,6 @@
 #include "operators/unary.h"
 #include "core/kernel.h"
+#include "utils/operator_utils.h"
 
 namespace infini
 {
@@ -32,9 +33,18 @@ namespace infini
                 IT_TODO_HALT();
             }
 
-            for (size_t offset = 0; offset < n; offset++)
+            auto input = op->getInputs(0);
+            if (input->isContiguous())
+                for (size_t offset = 0; offset < n; offset++)
+                {
+                    outptr[offset] = _doCompute(inptr[offset]);
+                }
+            else
             {
-                outptr[offset] = _doCompute(inptr[offset]);
+                auto strides = input->getStrides();
+                for (size_t offset = 0; offset < n; offset++)
+                    outptr[offset] = _doCompute(
+                        inptr[strided_offset(offset, outDim, strides)]);
             }
         }
 
@@ -69,11 +79,16 @@ namespace infini
             auto minValue = op->getMin();
             auto maxValue = op->getMax();
 
+            auto input = op->getInputs(0);
+            auto outDim = op->getOutput()->getDims();
+            auto strides = input->getStrides();
             auto n = op->getOutput()->size();
             for (size_t offset = 0; offset < n; offset++)
             {
-                auto val = *inptr++;
-                *outptr++ = (minValue && val < *minValue)   ? *minValue
+                auto val = input->isContiguous()
+                               ? inptr[offset]
+                               : inptr[strided_offset(offset, outDim, strides)];
+                outptr[offset] = (minValue && val < *minValue)   ? *minValue
                             : (maxValue && val > *maxValue) ? *maxValue
                                                             : val;
             }
@@ -44,4 +44,8 @@ std::string ConcatObj::toString() const {
     return os.str();
 }
 
+vector<int> ConcatObj::getOpAttrVector() const {
+    return {type.underlying(), dim};
+}
+
 } // namespace infini
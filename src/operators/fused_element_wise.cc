@@ -0,0 +1,100 @@
+#include "operators/fused_element_wise.h"
+#include "operators/unary.h"
+#include "utils/operator_utils.h"
+
+namespace infini
+{
+    FusedElementWiseObj::FusedElementWiseObj(GraphObj *graph, TensorVec inputs,
+                                             Tensor output,
+                                             vector<FusedInstr> program)
+        : OperatorObj(OpType::FusedElementWise, std::move(inputs), {output}),
+          program(std::move(program))
+    {
+        IT_ASSERT(checkValid(graph));
+    }
+
+    optional<vector<Shape>>
+    FusedElementWiseObj::inferShape(const TensorVec &inputs)
+    {
+        if (program.empty())
+            return std::nullopt;
+        // every register read must be written before
+        int numRegs = inputs.size();
+        for (auto &instr : program)
+        {
+            bool unary =
+                instr.type == OpType::Relu || instr.type == OpType::Clip;
+            bool rhsValid = unary ? instr.rhs == -1
+                                  : instr.rhs >= 0 && instr.rhs < numRegs;
+            if (!canFuse(instr.type) || instr.lhs < 0 ||
+                instr.lhs >= numRegs || !rhsValid)
+                return std::nullopt;
+            numRegs++;
+        }
+        Shape dims = inputs[0]->getDims();
+        for (size_t i = 1; i < inputs.size(); ++i)
+            dims = infer_broadcast(dims, inputs[i]->getDims());
+        return {{dims}};
+    }
+
+    std::string FusedElementWiseObj::toString() const
+    {
+        std::ostringstream os;
+        os << type.toString() << "[" << getGuid() << "]";
+        os << "(";
+        for (auto input : inputs)
+            os << vecToString(input->getDims()) << ",";
+        os << "program=[";
+        for (size_t i = 0; i < program.size(); ++i)
+        {
+            auto &instr = program[i];
+            os << (i ? "," : "") << "r" << inputs.size() + i << "="
+               << instr.type.toString() << "(r" << instr.lhs;
+            if (instr.rhs >= 0)
+                os << ",r" << instr.rhs;
+            os << ")";
+        }
+        os << "],input=";
+        for (auto input : inputs)
+            os << input->getGuid() << ",";
+        os << "output=" << outputs[0]->getGuid() << ")";
+        return os.str();
+    }
+
+    vector<int> FusedElementWiseObj::getOpAttrVector() const
+    {
+        vector<int> ret = {type.underlying()};
+        for (auto &instr : program)
+        {
+            ret.insert(ret.end(),
+                       {instr.type.underlying(), instr.lhs, instr.rhs});
+            for (auto bound : {instr.min, instr.max})
+                appendOptionalFloat(ret, bound);
+        }
+        return ret;
+    }
+
+    bool FusedElementWiseObj::canFuse(OpType type)
+    {
+        return type == OpType::Add || type == OpType::Sub ||
+               type == OpType::Mul || type == OpType::Div ||
+               type == OpType::Relu || type == OpType::Clip;
+    }
+
+    vector<FusedInstr> FusedElementWiseObj::programOf(const Operator &op)
+    {
+        auto type = op->getOpType();
+        if (type == OpType::FusedElementWise)
+            return as<FusedElementWiseObj>(op)->getProgram();
+        IT_ASSERT(canFuse(type));
+        if (type == OpType::Relu)
+            return {{type, 0, -1, std::nullopt, std::nullopt}};
+        if (type == OpType::Clip)
+        {
+            auto clip = as<ClipObj>(op);
+            return {{type, 0, -1, clip->getMin(), clip->getMax()}};
+        }
+        return {{type, 0, 1, std::nullopt, std::nullopt}};
+    }
+
+}; // namespace infini
@@ -4,24 +4,114 @@
 namespace infini
 {
 
+    namespace
+    {
+        // dims of `tensor` read through `permute`
+        Shape permuted(const Tensor &tensor, const vector<int> &permute)
+        {
+            auto dims = tensor->getDims();
+            if (permute.empty())
+                return dims;
+            IT_ASSERT(permute.size() == dims.size());
+            Shape ret(dims.size());
+            for (size_t i = 0; i < dims.size(); ++i)
+                ret[i] = dims[permute[i]];
+            return ret;
+        }
+
+        // logical dims {..., k, n} of a B packed in panels of `width`
+        // columns, stored as {..., n / width, k, width}
+        Shape unpacked(const Tensor &tensor, int width)
+        {
+            auto dims = tensor->getDims();
+            size_t r = dims.size();
+            Shape ret(dims.begin(), dims.end() - 3);
+            ret.emplace_back(dims[r - 2]);
+            ret.emplace_back(dims[r - 3] * width);
+            IT_ASSERT(dims[r - 1] == width);
+            return ret;
+        }
+
+        // the identity is stored as an empty permutation
+        vector<int> normalized(vector<int> permute)
+        {
+            for (size_t i = 0; i < permute.size(); ++i)
+                if (permute[i] != (int)i)
+                    return permute;
+            return {};
+        }
+    } // namespace
+
     MatmulObj::MatmulObj(GraphObj *graph, Tensor A, Tensor B, Tensor C, bool transA,
-                         bool transB)
-        : OperatorObj(OpType::MatMul, TensorVec{A, B}, {C}),
-          transA(transA), transB(transB)
+                         bool transB, vector<int> permA, vector<int> permB,
+                         Tensor bias, int panelB)
+        : OperatorObj(OpType::MatMul,
+                      bias ? TensorVec{A, B, bias} : TensorVec{A, B}, {C}),
+          transA(transA), transB(transB), permA(normalized(std::move(permA))),
+          permB(normalized(std::move(permB))), act(ActType::None),
+          panelB(panelB)
     {
+        IT_ASSERT(panelB >= 0);
+        IT_ASSERT(panelB == 0 || (!transB && this->permB.empty() &&
+                                  B->getRank() >= 3));
         IT_ASSERT(checkValid(graph));
     }
 
+    void MatmulObj::setAct(ActType act, std::optional<float> min,
+                           std::optional<float> max)
+    {
+        IT_ASSERT(act == ActType::Clip || (!min && !max));
+        this->act = act;
+        clipMin = min;
+        clipMax = max;
+    }
+
+    void MatmulObj::setPermA(vector<int> permA)
+    {
+        IT_ASSERT(permA.empty() || permA.size() == inputs[0]->getRank());
+        this->permA = normalized(std::move(permA));
+    }
+
+    void MatmulObj::setPermB(vector<int> permB)
+    {
+        IT_ASSERT(permB.empty() || permB.size() == inputs[1]->getRank());
+        this->permB = normalized(std::move(permB));
+    }
+
     string MatmulObj::toString() const
     {
         std::ostringstream os;
         os << "Matmul([" << (transA ? "A^T" : "A") << "," << (transB ? "B^T" : "B]")
+           << (permA.empty() ? "" : ",permA=" + vecToString(permA))
+           << (permB.empty() ? "" : ",permB=" + vecToString(permB))
+           << (panelB ? ",panelB=" + std::to_string(panelB) : "")
+           << (act == ActType::Relu   ? ",act=Relu"
+               : act == ActType::Clip ? ",act=Clip"
+                                      : "")
            << ",A=" << inputs[0]->getGuid()
-           << ",B=" << inputs[1]->getGuid() << ",C=" << outputs[0]->getGuid()
+           << ",B=" << inputs[1]->getGuid();
+        if (inputs.size() > 2)
+            os << ",bias=" << inputs[2]->getGuid();
+        os << ",C=" << outputs[0]->getGuid()
            << ",mnk=[" << m << "," << n << "," << k << "])";
         return os.str();
     }
 
+    vector<int> MatmulObj::getOpAttrVector() const
+    {
+        // the permutations are prefixed by their sizes to keep them apart
+        vector<int> ret = {type.underlying(), transA, transB,
+                           (int)permA.size()};
+        ret.insert(ret.end(), permA.begin(), permA.end());
+        ret.emplace_back(permB.size());
+        ret.insert(ret.end(), permB.begin(), permB.end());
+        ret.emplace_back(panelB);
+        ret.emplace_back(static_cast<int>(act));
+        for (auto bound : {clipMin, clipMax})
+            appendOptionalFloat(ret, bound);
+        return ret;
+    }
+
     optional<vector<Shape>> MatmulObj::inferShape(const TensorVec &inputs)
     {
         // =================================== 作业 ===================================
@@ -30,8 +120,8 @@ namespace infini
         // =================================== 作业 ===================================
         const auto A = inputs[0];
         const auto B = inputs[1];
-        auto aDims = A->getDims();
-        auto bDims = B->getDims();
+        auto aDims = permuted(A, permA);
+        auto bDims = panelB ? unpacked(B, panelB) : permuted(B, permB);
         auto aRank = aDims.size();
         auto bRank = bDims.size();
 
@@ -77,6 +167,15 @@ namespace infini
         outputShape.push_back(m);
         outputShape.push_back(n);
 
+        // the bias holds one value per column of C
+        if (inputs.size() > 2)
+        {
+            auto biasDims = inputs[2]->getDims();
+            if (biasDims.empty() || biasDims.size() > outputShape.size() ||
+                (int)inputs[2]->size() != n || biasDims.back() != n)
+                return std::nullopt;
+        }
+
         return {{outputShape}};
     }
 
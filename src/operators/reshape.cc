@@ -0,0 +1,50 @@
+#include "operators/reshape.h"
+
+namespace infini
+{
+    ReshapeObj::ReshapeObj(GraphObj *graph, Tensor input, Tensor output,
+                           Shape dims)
+        : OperatorObj(OpType::Reshape, {input}, {output}), dims(std::move(dims))
+    {
+        IT_ASSERT(checkValid(graph));
+    }
+
+    optional<vector<Shape>> ReshapeObj::inferShape(const TensorVec &inputs)
+    {
+        auto inDims = inputs[0]->getDims();
+        Shape outDims = dims;
+        size_t size = 1;
+        for (size_t i = 0; i < outDims.size(); ++i)
+        {
+            if (outDims[i] == 0)
+            {
+                if (i >= inDims.size())
+                    return std::nullopt;
+                outDims[i] = inDims[i];
+            }
+            size *= outDims[i];
+        }
+        if (size != inputs[0]->size())
+            return std::nullopt;
+        return vector<Shape>{outDims};
+    }
+
+    std::string ReshapeObj::toString() const
+    {
+        std::ostringstream os;
+        os << type.toString() << "[" << getGuid() << "]";
+        os << "(";
+        os << vecToString(inputs[0]->getDims()) << ",";
+        os << "dims=" << vecToString(dims) << ",";
+        os << "input=" << inputs[0]->getGuid() << ",";
+        os << "output=" << outputs[0]->getGuid() << ")";
+        return os.str();
+    }
+
+    vector<int> ReshapeObj::getOpAttrVector() const
+    {
+        vector<int> ret = dims;
+        ret.insert(ret.begin(), type.underlying());
+        return ret;
+    }
+}; // namespace infini
@@ -0,0 +1,62 @@
+#include "operators/split.h"
+#include "utils/operator_utils.h"
+
+namespace infini {
+SplitObj::SplitObj(GraphObj *graph, Tensor input,
+                   std::optional<TensorVec> outputs, int _dim,
+                   vector<int> sizes)
+    : OperatorObj(OpType::Split, {input},
+                  outputs ? *outputs : TensorVec(sizes.size(), nullptr)),
+      sizes(std::move(sizes)) {
+    dim = get_real_axis(_dim, input->getRank());
+    IT_ASSERT(checkValid(graph));
+}
+
+optional<vector<Shape>> SplitObj::inferShape(const TensorVec &inputs) {
+    Shape dims = inputs[0]->getDims();
+    int total = 0;
+    for (auto size : sizes) {
+        if (size <= 0)
+            return std::nullopt;
+        total += size;
+    }
+    if (sizes.empty() || total != dims[dim])
+        return std::nullopt;
+    vector<Shape> ret;
+    for (auto size : sizes) {
+        dims[dim] = size;
+        ret.emplace_back(dims);
+    }
+    return ret;
+}
+
+bool SplitObj::isContiguous() const {
+    auto dims = inputs[0]->getDims();
+    for (int i = 0; i < dim; ++i)
+        if (dims[i] != 1)
+            return false;
+    return true;
+}
+
+std::string SplitObj::toString() const {
+    std::ostringstream os;
+    os << "Split[" << getGuid() << "]";
+    os << "(";
+    os << vecToString(inputs[0]->getDims()) << ",";
+    os << "dim=" << dim << ",";
+    os << "sizes=" << vecToString(sizes) << ",";
+    os << "input=" << inputs[0]->getGuid() << ",";
+    os << "output=";
+    for (auto output : outputs)
+        os << output->getGuid() << ",";
+    os << ")";
+    return os.str();
+}
+
+vector<int> SplitObj::getOpAttrVector() const {
+    vector<int> ret = {type.underlying(), dim};
+    ret.insert(ret.end(), sizes.begin(), sizes.end());
+    return ret;
+}
+
+} // namespace infini
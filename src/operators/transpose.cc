@@ -52,4 +52,11 @@ namespace infini
         os << "output=" << outputs[0]->getGuid() << ")";
         return os.str();
     }
+
+    vector<int> TransposeObj::getOpAttrVector() const
+    {
+        vector<int> ret = transposePermute;
+        ret.insert(ret.begin(), type.underlying());
+        return ret;
+    }
 }; // namespace infini
@@ -54,6 +54,14 @@ namespace infini
         return os.str();
     }
 
+    vector<int> ClipObj::getOpAttrVector() const
+    {
+        vector<int> ret = {type.underlying()};
+        for (auto bound : {minValue, maxValue})
+            appendOptionalFloat(ret, bound);
+        return ret;
+    }
+
     CastObj::CastObj(GraphObj *graph, Tensor input, Tensor output, CastType type)
         : OperatorObj(OpType::Cast, {input}, {output}), castType(type)
     {
@@ -90,6 +98,11 @@ namespace infini
         return os.str();
     }
 
+    vector<int> CastObj::getOpAttrVector() const
+    {
+        return {type.underlying(), static_cast<int>(castType)};
+    }
+
     DataType CastObj::getOutputDataType() const
     {
         switch (castType)
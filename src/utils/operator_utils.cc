@@ -69,6 +69,17 @@ size_t delocate_index(const Shape &shapeIndex, const Shape &shape,
     return ans;
 }
 
+size_t strided_offset(size_t index, const Shape &shape,
+                      const vector<size_t> &strides) {
+    IT_ASSERT(shape.size() == strides.size());
+    size_t ans = 0;
+    for (size_t i = shape.size(); i > 0; --i) {
+        ans += index % shape[i - 1] * strides[i - 1];
+        index /= shape[i - 1];
+    }
+    return ans;
+}
+
 std::string device_to_str(Device device) {
     std::string deviceStr;
     switch (device) {
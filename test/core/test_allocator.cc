@@ -71,4 +71,52 @@ namespace infini
         EXPECT_EQ(ptr1, ptr2);
     }
 
+    TEST(Allocator, testStats)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Allocator allocator = Allocator(runtime);
+        size_t offsetA = allocator.alloc(48);
+        size_t offsetB = allocator.alloc(48);
+        allocator.alloc(48);
+        allocator.free(offsetA, 48);
+        allocator.free(offsetB, 48);
+        auto stats = allocator.getStats();
+        EXPECT_EQ(stats.peak, 144u);
+        EXPECT_EQ(stats.used, 48u);
+        EXPECT_EQ(stats.numFreeBlocks, 1u);
+        EXPECT_EQ(stats.freeBytes, 96u);
+        EXPECT_EQ(stats.freeBlockHistogram.at(128), 1u);
+        EXPECT_EQ(stats.arenaSize, 0u);
+        // reuse part of the hole
+        allocator.alloc(32);
+        stats = allocator.getStats();
+        EXPECT_EQ(stats.requested, 176u);
+        EXPECT_EQ(stats.bytesSaved(), 32u);
+        EXPECT_EQ(stats.largestFreeBlock, 64u);
+        allocator.getPtr();
+        EXPECT_EQ(allocator.getStats().arenaSize, 144u);
+    }
+
+    TEST(Allocator, testMemoryPlan)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor t = g->addTensor({2, 3}, DataType::Float32);
+        for (int i = 0; i < 3; ++i)
+            t = g->addOp<ReluObj>(t, nullptr)->getOutput();
+        g->dataMalloc();
+        auto &plan = g->getMemoryPlan();
+        ASSERT_EQ(plan.entries.size(), 4u);
+        EXPECT_EQ(plan.entries[0].allocStep, -1);
+        EXPECT_EQ(plan.entries[0].freeStep, 0);
+        EXPECT_EQ(plan.entries[3].allocStep, 2);
+        EXPECT_EQ(plan.entries[3].freeStep, 3);
+        // a chain only ever needs two buffers
+        EXPECT_EQ(plan.stats.peak, 48u);
+        EXPECT_EQ(plan.stats.bytesSaved(), 48u);
+        EXPECT_NE(plan.toJson().find("\"peak\": 48"), string::npos);
+        EXPECT_EQ(plan.toCsv().substr(0, plan.toCsv().find('\n')),
+                  "guid,fuid,offset,bytes,alloc_step,free_step");
+    }
+
 } // namespace infini
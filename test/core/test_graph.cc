@@ -1,8 +1,13 @@
 #include "core/graph.h"
 #include "core/kernel.h"
 #include "core/runtime.h"
+#include "operators/concat.h"
+#include "operators/element_wise.h"
 #include "operators/matmul.h"
+#include "operators/reshape.h"
+#include "operators/split.h"
 #include "operators/transpose.h"
+#include "operators/unary.h"
 
 #include "test.h"
 
@@ -37,4 +42,619 @@ namespace infini
         EXPECT_EQ(op->getTransA(), false);
         EXPECT_EQ(op->getTransB(), true);
     }
-}
\ No newline at end of file
+
+    TEST(Graph, BindExternalBuffers)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor i = g->addTensor({2, 3}, DataType::Float32);
+        auto relu = g->addOp<ReluObj>(i, nullptr);
+        auto o = g->addOp<TransposeObj>(relu->getOutput(), nullptr,
+                                        Shape{1, 0})
+                     ->getOutput();
+
+        vector<float> in{-1, 2, -3, 4, -5, 6}, out(6);
+        EXPECT_THROW(g->bindInput(i, in.data(), 4), Exception);
+        EXPECT_THROW(g->bindOutput(i, in.data(), 24), Exception);
+        g->bindInput(i, in.data(), in.size() * sizeof(float));
+        g->bindOutput(o, out.data(), out.size() * sizeof(float));
+        g->dataMalloc();
+        EXPECT_EQ(i->getRawDataPtr<float *>(), in.data());
+        EXPECT_EQ(o->getRawDataPtr<float *>(), out.data());
+
+        runtime->run(g);
+        EXPECT_EQ(out, (vector<float>{0, 4, 2, 0, 0, 6}));
+
+        // rebinding for the next request only swaps the pointers
+        vector<float> in2{1, 1, 1, 1, 1, 1}, out2(6);
+        g->bindInput(i, in2.data(), in2.size() * sizeof(float));
+        g->bindOutput(o, out2.data(), out2.size() * sizeof(float));
+        runtime->run(g);
+        EXPECT_EQ(out2, (vector<float>{1, 1, 1, 1, 1, 1}));
+    }
+
+    TEST(Graph, BindAfterCachedPlan)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor i = g->addTensor({1, 3}, DataType::Float32);
+        auto o = g->addOp<ReluObj>(i, nullptr)->getOutput();
+        g->setInputShapes({{2, 3}});
+        g->setInputShapes({{1, 3}});
+
+        vector<float> in{-1, 2, -3, 4, -5, 6}, out(6);
+        g->bindInput(i, in.data(), in.size() * sizeof(float));
+        g->bindOutput(o, out.data(), out.size() * sizeof(float));
+        // the cached plan of this shape placed both in the arena
+        g->setInputShapes({{2, 3}});
+        EXPECT_EQ(g->getPlanCache().getHits(), 1u);
+        EXPECT_EQ(i->getRawDataPtr<float *>(), in.data());
+        EXPECT_EQ(o->getRawDataPtr<float *>(), out.data());
+        runtime->run(g);
+        EXPECT_EQ(out, (vector<float>{0, 2, 0, 4, 0, 6}));
+
+        // the buffers hold two rows: a bound input is not padded to its
+        // bucket, and growing past them fails
+        g->getPlanCache().setBuckets(0, {4});
+        g->setInputShapes({{1, 3}});
+        EXPECT_EQ(i->getDims(), (Shape{1, 3}));
+        EXPECT_THROW(g->setInputShapes({{3, 3}}), Exception);
+    }
+
+    TEST(Graph, ReplanAfterShapeChange)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor i = g->addTensor({1, 3}, DataType::Float32);
+        auto t = g->addOp<ReluObj>(i, nullptr)->getOutput();
+        auto o = g->addOp<TransposeObj>(t, nullptr, Shape{1, 0})->getOutput();
+        g->dataMalloc();
+        auto smallArena = g->getMemoryPlan().stats.arenaSize;
+
+        i->setShape({4, 3});
+        g->shape_infer();
+        EXPECT_EQ(o->getDims(), (Shape{3, 4}));
+        g->dataMalloc();
+        EXPECT_GT(g->getMemoryPlan().stats.arenaSize, smallArena);
+        i->setData(IncrementalGenerator());
+        runtime->run(g);
+        EXPECT_TRUE(o->equalData(
+            vector<float>{0, 3, 6, 9, 1, 4, 7, 10, 2, 5, 8, 11}));
+
+        // a smaller batch reuses the grown arena
+        auto base = i->getRawDataPtr<void *>();
+        auto arena = g->getMemoryPlan().stats.arenaSize;
+        i->setShape({2, 3});
+        g->shape_infer();
+        g->dataMalloc();
+        EXPECT_EQ(g->getMemoryPlan().stats.arenaSize, arena);
+        EXPECT_EQ(i->getRawDataPtr<void *>(), base);
+        i->setData(IncrementalGenerator());
+        runtime->run(g);
+        EXPECT_TRUE(o->equalData(vector<float>{0, 3, 1, 4, 2, 5}));
+    }
+
+    TEST(Graph, IncrementalShapeInfer)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor x = g->addTensor({1, 3}, DataType::Float32);
+        Tensor y = g->addTensor({4, 3}, DataType::Float32);
+        Tensor z = g->addTensor({2, 3}, DataType::Float32);
+        auto sum = g->addOp<AddObj>(x, y, nullptr)->getOutput();
+        auto r = g->addOp<ReluObj>(sum, nullptr)->getOutput();
+        auto t = g->addOp<TransposeObj>(z, nullptr, Shape{1, 0})->getOutput();
+
+        // the broadcast hides the change of x, so it stops at the add
+        x->setShape({4, 3});
+        EXPECT_TRUE(g->shape_infer({x}).empty());
+
+        // only the cone of y changes
+        y->setShape({5, 3});
+        x->setShape({1, 3});
+        EXPECT_EQ(g->shape_infer({x, y}), (TensorVec{sum, r}));
+        EXPECT_EQ(r->getDims(), (Shape{5, 3}));
+        EXPECT_EQ(t->getDims(), (Shape{3, 2}));
+
+        z->setShape({6, 3});
+        EXPECT_EQ(g->shape_infer(), (TensorVec{t}));
+        EXPECT_EQ(t->getDims(), (Shape{3, 6}));
+    }
+
+    TEST(Graph, Resizable)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor x = g->addTensor({2, 3}, DataType::Float32);
+        Tensor w = g->addTensor({2, 3}, DataType::Float32);
+        w->setWeight();
+        auto a = g->addOp<AddObj>(x, w, nullptr)->getOutput();
+        auto r = g->addOp<ReluObj>(w, nullptr)->getOutput();
+        auto relu = g->addOp<ReluObj>(r, nullptr);
+        EXPECT_TRUE(g->isResizable(a));
+        EXPECT_FALSE(g->isResizable(relu->getOutput()));
+        // rewiring drops what was found so far
+        g->replaceInput(relu, r, a);
+        EXPECT_TRUE(g->isResizable(relu->getOutput()));
+    }
+
+    TEST(Graph, PlanCache)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor i = g->addTensor({1, 3}, DataType::Float32);
+        auto t = g->addOp<ReluObj>(i, nullptr)->getOutput();
+        auto o = g->addOp<TransposeObj>(t, nullptr, Shape{1, 0})->getOutput();
+        g->getPlanCache().setBuckets(0, {1, 2, 4, 8});
+
+        g->setInputShapes({{3, 3}});
+        EXPECT_EQ(i->getDims(), (Shape{4, 3}));
+        EXPECT_EQ(o->getDims(), (Shape{3, 4}));
+        auto plan4 = g->getMemoryPlan().stats.peak;
+        g->setInputShapes({{1, 3}});
+        EXPECT_EQ(o->getDims(), (Shape{3, 1}));
+        EXPECT_EQ(g->getPlanCache().getMisses(), 2u);
+
+        // batch 4 is in the same bucket as batch 3
+        g->setInputShapes({{4, 3}});
+        EXPECT_EQ(g->getPlanCache().getHits(), 1u);
+        EXPECT_EQ(o->getDims(), (Shape{3, 4}));
+        EXPECT_EQ(g->getMemoryPlan().stats.peak, plan4);
+        i->setData(IncrementalGenerator());
+        runtime->run(g);
+        EXPECT_TRUE(o->equalData(
+            vector<float>{0, 3, 6, 9, 1, 4, 7, 10, 2, 5, 8, 11}));
+    }
+
+    TEST(Graph, PlanCacheEviction)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor i = g->addTensor({1, 3}, DataType::Float32);
+        auto o = g->addOp<ReluObj>(i, nullptr)->getOutput();
+        auto &cache = g->getPlanCache();
+        cache.setCapacity(2);
+
+        g->setInputShapes({{1, 3}});
+        g->setInputShapes({{2, 3}});
+        // batch 1 is now used more recently than batch 2
+        g->setInputShapes({{1, 3}});
+        EXPECT_EQ(cache.getHits(), 1u);
+        g->setInputShapes({{3, 3}});
+        EXPECT_EQ(cache.size(), 2u);
+        EXPECT_EQ(cache.getEvictions(), 1u);
+
+        g->setInputShapes({{1, 3}});
+        EXPECT_EQ(cache.getHits(), 2u);
+        g->setInputShapes({{2, 3}});
+        EXPECT_EQ(cache.getMisses(), 4u);
+        EXPECT_EQ(cache.getEvictions(), 2u);
+        EXPECT_EQ(o->getDims(), (Shape{2, 3}));
+
+        cache.setCapacity(1);
+        EXPECT_EQ(cache.size(), 1u);
+        EXPECT_EQ(cache.getEvictions(), 3u);
+        g->setInputShapes({{2, 3}});
+        EXPECT_EQ(cache.getHits(), 3u);
+    }
+
+    TEST(Graph, MemoryAwareSort)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor x = g->addTensor({1, 64}, DataType::Float32);
+        // the branches are expanded first, then reduced by the matmuls
+        TensorVec wide;
+        for (int i = 0; i < 4; ++i)
+            wide.emplace_back(g->addOp<ReluObj>(x, nullptr)->getOutput());
+        for (auto &t : wide)
+        {
+            Tensor w = g->addTensor({64, 1}, DataType::Float32);
+            w->setWeight();
+            g->addOp<MatmulObj>(t, w, nullptr);
+        }
+        ASSERT_TRUE(g->topo_sort());
+        size_t peak = g->estimatePeak();
+
+        auto report = g->memory_aware_sort();
+        EXPECT_EQ(report.peakBefore, peak);
+        EXPECT_LT(report.peakAfter, report.peakBefore);
+        EXPECT_EQ(g->estimatePeak(), report.peakAfter);
+        // relu and matmul alternate
+        auto &ops = g->getOperators();
+        for (size_t i = 0; i < ops.size(); ++i)
+            EXPECT_EQ(ops[i]->getOpType(),
+                      i % 2 ? OpType::MatMul : OpType::Relu);
+
+        auto beam = g->memory_aware_sort(4);
+        EXPECT_EQ(beam.peakAfter, report.peakAfter);
+        g->dataMalloc();
+        EXPECT_EQ(g->getMemoryPlan().stats.peak, report.peakAfter);
+    }
+
+    TEST(Graph, MemoryAwareSortAfterPlanCache)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor x = g->addTensor({1, 64}, DataType::Float32);
+        TensorVec wide, weights, outputs;
+        for (int i = 0; i < 4; ++i)
+            wide.emplace_back(g->addOp<ReluObj>(x, nullptr)->getOutput());
+        for (auto &t : wide)
+        {
+            Tensor w = weights.emplace_back(
+                g->addTensor({64, 1}, DataType::Float32));
+            w->setWeight();
+            outputs.emplace_back(
+                g->addOp<MatmulObj>(t, w, nullptr)->getOutput());
+        }
+        g->setInputShapes({{1, 64}});
+        EXPECT_EQ(g->getPlanCache().size(), 1u);
+
+        // the cached offsets were planned for the old order
+        auto report = g->memory_aware_sort();
+        EXPECT_LT(report.peakAfter, report.peakBefore);
+        EXPECT_EQ(g->getPlanCache().size(), 0u);
+        EXPECT_FALSE(x->hasData());
+        g->setInputShapes({{1, 64}});
+        EXPECT_EQ(g->getPlanCache().getMisses(), 2u);
+        EXPECT_EQ(g->getMemoryPlan().stats.peak, report.peakAfter);
+
+        x->setData(IncrementalGenerator());
+        for (auto &w : weights)
+            w->setData(OneGenerator());
+        runtime->run(g);
+        for (auto &o : outputs)
+            EXPECT_TRUE(o->equalData(vector<float>{2016}));
+    }
+
+    TEST(Graph, MemoryAwareSortKeepsOptimalOrder)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor x = g->addTensor({2, 4}, DataType::Float32);
+        Tensor y = g->addOp<ReluObj>(x, nullptr)->getOutput();
+        Tensor z = g->addOp<ReluObj>(y, nullptr)->getOutput();
+        g->dataMalloc();
+        g->setInputShapes({{2, 4}});
+        EXPECT_EQ(g->getPlanCache().size(), 1u);
+        auto ops = g->getOperators();
+
+        // a chain has a single order: the plan is kept
+        auto report = g->memory_aware_sort(4);
+        EXPECT_EQ(report.peakAfter, report.peakBefore);
+        EXPECT_EQ(g->getOperators(), ops);
+        EXPECT_TRUE(x->hasData());
+        EXPECT_TRUE(z->hasData());
+        EXPECT_EQ(g->getPlanCache().size(), 1u);
+
+        x->setData(IncrementalGenerator());
+        runtime->run(g);
+        EXPECT_TRUE(z->equalData(vector<float>{0, 1, 2, 3, 4, 5, 6, 7}));
+    }
+
+    TEST(Graph, MemoryBudgetSpill)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor x = g->addTensor({1, 16}, DataType::Float32);
+        // `a` waits while a wide branch runs
+        auto a = g->addOp<ReluObj>(x, nullptr)->getOutput();
+        auto m = g->addOp<ConcatObj>(TensorVec{x, x, x, x}, nullptr, 0)
+                     ->getOutput();
+        auto wide = g->addOp<ReluObj>(m, nullptr)->getOutput();
+        auto o = g->addOp<ReluObj>(a, nullptr)->getOutput();
+        g->dataMalloc();
+        size_t peak = g->getMemoryPlan().stats.peak;
+
+        g->setMemoryBudget(peak - 1);
+        g->dataMalloc();
+        EXPECT_LT(g->getMemoryPlan().stats.peak, peak);
+        ASSERT_FALSE(g->getSpillFile()->empty());
+
+        for (int run = 0; run < 2; ++run)
+        {
+            x->setData(IncrementalGenerator());
+            runtime->run(g);
+            EXPECT_TRUE(o->equalData(vector<float>{0, 1, 2, 3, 4, 5, 6, 7, 8,
+                                                   9, 10, 11, 12, 13, 14, 15}));
+            EXPECT_EQ(wide->getDims(), (Shape{4, 16}));
+        }
+
+        g->setMemoryBudget(64);
+        EXPECT_THROW(g->dataMalloc(), Exception);
+    }
+
+    TEST(Graph, TopoSort)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        {
+            // a deep chain whose operators were added back to front
+            Graph g = make_ref<GraphObj>(runtime);
+            TensorVec t;
+            for (int i = 0; i <= 10000; ++i)
+                t.emplace_back(g->addTensor({1}, DataType::Float32));
+            for (int i = 9999; i >= 0; --i)
+                g->addOpWithOutputs<ReluObj>(t[i], t[i + 1]);
+            ASSERT_TRUE(g->topo_sort());
+            auto &ops = g->getOperators();
+            for (int i = 0; i < 10000; ++i)
+                EXPECT_EQ(ops[i]->getInputs(0), t[i]);
+        }
+        {
+            Graph g = make_ref<GraphObj>(runtime);
+            Tensor i = g->addTensor({1}, DataType::Float32);
+            Tensor a = g->addTensor({1}, DataType::Float32);
+            Tensor b = g->addTensor({1}, DataType::Float32);
+            Tensor c = g->addTensor({1}, DataType::Float32);
+            Tensor d = g->addTensor({1}, DataType::Float32);
+            g->addOpWithOutputs<ReluObj>(i, d);
+            auto ab = g->addOpWithOutputs<AddObj>(b, d, a);
+            auto ba = g->addOpWithOutputs<ReluObj>(a, b);
+            g->addOpWithOutputs<ReluObj>(a, c);
+            EXPECT_FALSE(g->topo_sort());
+            auto cycle = g->getCycleOperators();
+            ASSERT_EQ(cycle.size(), 2u);
+            EXPECT_EQ(cycle[0], ab);
+            EXPECT_EQ(cycle[1], ba);
+            EXPECT_THROW(g->dataMalloc(), Exception);
+        }
+    }
+
+    TEST(Graph, IndexedContainers)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        TensorVec t;
+        OpVec ops;
+        for (int i = 0; i <= 1000; ++i)
+            t.emplace_back(g->addTensor({1}, DataType::Float32));
+        for (int i = 0; i < 1000; ++i)
+            ops.emplace_back(g->addOpWithOutputs<ReluObj>(t[i], t[i + 1]));
+        for (int i = 0; i <= 1000; ++i)
+            EXPECT_EQ(g->getTensor(t[i]->getFuid()), t[i]);
+
+        // cut the chain after the first operator
+        for (int i = 999; i >= 1; --i)
+            g->removeOperator(ops[i]);
+        for (int i = 2; i <= 1000; ++i)
+            g->removeTensor(t[i]);
+        EXPECT_FALSE(g->hasOperator(ops[1]));
+        EXPECT_FALSE(g->hasTensor(t[2]));
+        EXPECT_EQ(g->getTensor(t[2]->getFuid()), nullptr);
+        EXPECT_EQ(g->getTensor(t[1]->getFuid()), t[1]);
+
+        ASSERT_EQ(g->getOperators().size(), 1u);
+        EXPECT_EQ(g->getOperators()[0], ops[0]);
+        ASSERT_EQ(g->getTensors().size(), 2u);
+        EXPECT_EQ(g->getTensors()[1], t[1]);
+        EXPECT_EQ(g->getTensor(t[1]->getFuid()), t[1]);
+        EXPECT_TRUE(g->hasOperator(ops[0]));
+    }
+
+    TEST(Graph, FoldConstants)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor x = g->addTensor({3, 2}, DataType::Float32);
+        Tensor w = g->addTensor({2, 3}, DataType::Float32);
+        w->setConstant();
+        auto t = g->addOp<TransposeObj>(w, nullptr, Shape{1, 0});
+        auto relu = g->addOp<ReluObj>(t->getOutput(), nullptr);
+        auto sum = g->addOp<AddObj>(t->getOutput(), relu->getOutput(), nullptr);
+        auto add = g->addOp<AddObj>(x, sum->getOutput(), nullptr);
+
+        g->weightMalloc();
+        w->setData(IncrementalGenerator());
+        EXPECT_EQ(g->fold_constants(), 3u);
+        EXPECT_EQ(g->getOperators(), OpVec{add});
+        Tensor folded = sum->getOutput();
+        EXPECT_TRUE(folded->isConstant());
+        EXPECT_EQ(folded->getSource(), nullptr);
+        EXPECT_FALSE(g->hasTensor(w));
+        EXPECT_FALSE(g->hasTensor(t->getOutput()));
+        // only the folded result is left in the store
+        EXPECT_EQ(g->getWeightStore()->numSlots(), 1u);
+        EXPECT_EQ(folded->getRawDataPtr<void *>(),
+                  g->getWeightStore()->getPtr(0));
+        EXPECT_EQ(g->getWeightStore()->getBytes(), 64u);
+        EXPECT_TRUE(g->checkValid());
+
+        g->dataMalloc();
+        x->setData(IncrementalGenerator());
+        runtime->run(g);
+        EXPECT_TRUE(folded->equalData(vector<float>{0, 6, 2, 8, 4, 10}));
+        EXPECT_TRUE(add->getOutput()->equalData(
+            vector<float>{0, 7, 4, 11, 8, 15}));
+    }
+
+    TEST(Graph, EliminateCommonSubexpressions)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor x = g->addTensor({2, 3}, DataType::Float32);
+        Tensor w = g->addTensor({2, 3}, DataType::Float32);
+        // the same weight transposed twice, each read by its own matmul
+        auto t1 = g->addOp<TransposeObj>(w, nullptr, Shape{1, 0});
+        auto t2 = g->addOp<TransposeObj>(w, nullptr, Shape{1, 0});
+        auto m1 = g->addOp<MatmulObj>(x, t1->getOutput(), nullptr);
+        auto m2 = g->addOp<MatmulObj>(x, t2->getOutput(), nullptr);
+        // clips with other bounds are kept apart
+        auto c1 = g->addOp<ClipObj>(m1->getOutput(), nullptr, 0.f, 6.f);
+        auto c2 = g->addOp<ClipObj>(m2->getOutput(), nullptr, 0.f,
+                                    std::nullopt);
+        auto add = g->addOp<AddObj>(c1->getOutput(), c2->getOutput(), nullptr);
+
+        EXPECT_EQ(g->eliminate_common_subexpressions(), 2u);
+        EXPECT_EQ(g->getOperators().size(), 5u);
+        EXPECT_FALSE(g->hasOperator(t2));
+        EXPECT_FALSE(g->hasOperator(m2));
+        EXPECT_EQ(c2->getInputs(0), m1->getOutput());
+        EXPECT_EQ(m1->getOutput()->getTargets().size(), 2u);
+        EXPECT_TRUE(g->checkValid());
+        EXPECT_EQ(g->eliminate_common_subexpressions(), 0u);
+
+        g->dataMalloc();
+        x->setData(IncrementalGenerator());
+        w->setData(IncrementalGenerator());
+        runtime->run(g);
+        EXPECT_TRUE(
+            add->getOutput()->equalData(vector<float>{10, 20, 20, 56}));
+
+        // a duplicate read twice by the same operator
+        Graph h = make_ref<GraphObj>(runtime);
+        Tensor y = h->addTensor({2, 3}, DataType::Float32);
+        auto r1 = h->addOp<ReluObj>(y, nullptr);
+        auto r2 = h->addOp<ReluObj>(y, nullptr);
+        auto mul = h->addOp<MulObj>(r2->getOutput(), r2->getOutput(), nullptr);
+        auto sum = h->addOp<AddObj>(r1->getOutput(), mul->getOutput(), nullptr);
+        EXPECT_EQ(h->eliminate_common_subexpressions(), 1u);
+        EXPECT_EQ(mul->getInputs(),
+                  (TensorVec{r1->getOutput(), r1->getOutput()}));
+        EXPECT_EQ(r1->getOutput()->getTargets().size(), 3u);
+        EXPECT_TRUE(h->checkValid());
+
+        h->dataMalloc();
+        y->setData(IncrementalGenerator());
+        runtime->run(h);
+        EXPECT_TRUE(
+            sum->getOutput()->equalData(vector<float>{0, 2, 6, 12, 20, 30}));
+    }
+
+    TEST(Graph, DeadCodeElimination)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor x = g->addTensor({2, 3}, DataType::Float32);
+        Tensor y = g->addTensor({2, 3}, DataType::Float32);
+        Tensor z = g->addTensor({3, 2}, DataType::Float32);
+        auto relu = g->addOp<ReluObj>(x, nullptr);
+        auto add = g->addOp<AddObj>(relu->getOutput(), y, nullptr);
+        // a side branch nobody reads
+        auto t = g->addOp<TransposeObj>(relu->getOutput(), nullptr,
+                                        Shape{1, 0});
+        auto side = g->addOp<MulObj>(t->getOutput(), z, nullptr);
+        EXPECT_EQ(g->getOutputs().size(), 2u);
+        EXPECT_EQ(g->eliminate_dead_code(), 0u);
+
+        g->setOutputs({add->getOutput()});
+        EXPECT_EQ(g->getOutputs(), TensorVec{add->getOutput()});
+        EXPECT_TRUE(g->isOutput(add->getOutput()));
+        EXPECT_FALSE(g->isOutput(side->getOutput()));
+        EXPECT_EQ(g->opsNeededFor({relu->getOutput()}),
+                  (vector<bool>{true, false, false, false}));
+
+        EXPECT_EQ(g->eliminate_dead_code(), 2u);
+        EXPECT_EQ(g->getOperators(), (OpVec{relu, add}));
+        EXPECT_FALSE(g->hasTensor(z));
+        EXPECT_FALSE(g->hasTensor(side->getOutput()));
+        EXPECT_EQ(relu->getOutput()->getTargets(), OpVec{add});
+        EXPECT_EQ(relu->getSuccessors(), OpVec{add});
+        EXPECT_TRUE(g->checkValid());
+
+        g->dataMalloc();
+        x->setData(IncrementalGenerator());
+        y->setData(IncrementalGenerator());
+        // only the relu runs
+        runtime->run(g, {relu->getOutput()});
+        EXPECT_TRUE(relu->getOutput()->equalData(
+            vector<float>{0, 1, 2, 3, 4, 5}));
+        runtime->run(g);
+        EXPECT_TRUE(add->getOutput()->equalData(
+            vector<float>{0, 2, 4, 6, 8, 10}));
+    }
+
+    TEST(Graph, ConcatInPlace)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor x = g->addTensor({2, 3}, DataType::Float32);
+        Tensor y = g->addTensor({1, 3}, DataType::Float32);
+        auto rx = g->addOp<ReluObj>(x, nullptr);
+        auto ry = g->addOp<ReluObj>(y, nullptr);
+        auto concat = g->addOp<ConcatObj>(
+            TensorVec{rx->getOutput(), ry->getOutput()}, nullptr, 0);
+        // along an inner axis the slices are strided and stay copies
+        auto inner = g->addOp<ConcatObj>(
+            TensorVec{concat->getOutput(), concat->getOutput()}, nullptr, 1);
+        g->dataMalloc();
+
+        // the relus write straight into the concat output
+        auto base = concat->getOutput()->getRawDataPtr<float *>();
+        EXPECT_EQ(rx->getOutput()->getRawDataPtr<float *>(), base);
+        EXPECT_EQ(ry->getOutput()->getRawDataPtr<float *>(), base + 6);
+        EXPECT_NE(inner->getOutput()->getRawDataPtr<float *>(), base);
+
+        x->setData(IncrementalGenerator());
+        y->setData(IncrementalGenerator());
+        runtime->run(g);
+        EXPECT_TRUE(concat->getOutput()->equalData(
+            vector<float>{0, 1, 2, 3, 4, 5, 0, 1, 2}));
+        EXPECT_TRUE(inner->getOutput()->equalData(vector<float>{
+            0, 1, 2, 0, 1, 2, 3, 4, 5, 3, 4, 5, 0, 1, 2, 0, 1, 2}));
+    }
+
+    TEST(Graph, StridedViews)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor x = g->addTensor({2, 3}, DataType::Float32);
+        Tensor y = g->addTensor({3, 2}, DataType::Float32);
+        Tensor z = g->addTensor({2, 4}, DataType::Float32);
+        auto rx = g->addOp<ReluObj>(x, nullptr)->getOutput();
+        auto rz = g->addOp<ReluObj>(z, nullptr)->getOutput();
+        auto trans = g->addOp<TransposeObj>(rx, nullptr, Shape{1, 0});
+        auto add = g->addOp<AddObj>(trans->getOutput(), y, nullptr);
+        auto split = g->addOp<SplitObj>(rz, std::nullopt, 1, vector<int>{2, 2});
+        auto relu = g->addOp<ReluObj>(split->getOutput(1), nullptr);
+        // read by a kernel that needs contiguous data, so it is copied
+        auto reshape =
+            g->addOp<ReshapeObj>(split->getOutput(0), nullptr, Shape{4});
+        g->dataMalloc();
+
+        auto t = trans->getOutput();
+        EXPECT_EQ(t->getRawDataPtr<float *>(), rx->getRawDataPtr<float *>());
+        EXPECT_EQ(t->getStrides(), (vector<size_t>{1, 3}));
+        auto piece = split->getOutput(1);
+        EXPECT_EQ(piece->getRawDataPtr<float *>(),
+                  rz->getRawDataPtr<float *>() + 2);
+        EXPECT_EQ(piece->getStrides(), (vector<size_t>{4, 1}));
+        EXPECT_TRUE(split->getOutput(0)->isContiguous());
+
+        x->setData(IncrementalGenerator());
+        y->setData(IncrementalGenerator());
+        z->setData(IncrementalGenerator());
+        runtime->run(g);
+        EXPECT_TRUE(
+            add->getOutput()->equalData(vector<float>{0, 4, 3, 7, 6, 10}));
+        EXPECT_TRUE(relu->getOutput()->equalData(vector<float>{2, 3, 6, 7}));
+        EXPECT_TRUE(reshape->getOutput()->equalData(vector<float>{0, 1, 4, 5}));
+        // views compare in their logical order
+        EXPECT_TRUE(t->equalData(vector<float>{0, 3, 1, 4, 2, 5}));
+        EXPECT_TRUE(piece->equalData(relu->getOutput()));
+    }
+
+    TEST(Graph, RebindInputOfTranspose)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor x = g->addTensor({2, 3}, DataType::Float32);
+        Tensor z = g->addTensor({2, 4}, DataType::Float32);
+        auto trans = g->addOp<TransposeObj>(x, nullptr, Shape{1, 0});
+        auto relu = g->addOp<ReluObj>(trans->getOutput(), nullptr);
+        auto split = g->addOp<SplitObj>(z, std::nullopt, 1, vector<int>{2, 2});
+        auto piece = g->addOp<ReluObj>(split->getOutput(1), nullptr);
+        g->dataMalloc();
+        // graph inputs can move, so nothing views them
+        EXPECT_TRUE(trans->getOutput()->isContiguous());
+        EXPECT_TRUE(split->getOutput(1)->isContiguous());
+
+        vector<float> xData{0, 1, 2, 3, 4, 5}, zData{0, 1, 2, 3, 4, 5, 6, 7};
+        g->bindInput(x, xData.data(), xData.size() * sizeof(float));
+        g->bindInput(z, zData.data(), zData.size() * sizeof(float));
+        runtime->run(g);
+        EXPECT_TRUE(
+            relu->getOutput()->equalData(vector<float>{0, 3, 1, 4, 2, 5}));
+        EXPECT_TRUE(piece->getOutput()->equalData(vector<float>{2, 3, 6, 7}));
+    }
+}
@@ -0,0 +1,100 @@
+#include "core/graph.h"
+#include "core/pass_manager.h"
+#include "core/runtime.h"
+#include "operators/element_wise.h"
+#include "operators/matmul.h"
+#include "operators/transpose.h"
+
+#include "test.h"
+
+namespace infini
+{
+    static Graph buildGraph()
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor i1 = g->addTensor({2, 3, 4, 5}, DataType::Float32);
+        Tensor i2 = g->addTensor({2, 3, 4, 5}, DataType::Float32);
+        Tensor t1 = g->addTensor({2, 3, 5, 4}, DataType::Float32);
+        Tensor t2 = g->addTensor({2, 3, 4, 5}, DataType::Float32);
+        Tensor t3 = g->addTensor({2, 3, 5, 4}, DataType::Float32);
+        Tensor o = g->addTensor({2, 3, 4, 4}, DataType::Float32);
+        g->addOpWithOutputs<TransposeObj>(i1, t1, Shape{0, 1, 3, 2});
+        g->addOpWithOutputs<TransposeObj>(t1, t2, Shape{0, 1, 3, 2});
+        g->addOpWithOutputs<TransposeObj>(i2, t3, Shape{0, 1, 3, 2});
+        g->addOpWithOutputs<MatmulObj>(t2, t3, o);
+        return g;
+    }
+
+    TEST(PassManager, Stats)
+    {
+        Graph g = buildGraph();
+        auto pm = PassManager::standard();
+        pm.run(*g);
+        auto &stats = pm.getStats();
+        ASSERT_EQ(stats.size(), 10u);
+        EXPECT_EQ(stats[0].name, "optimize");
+        EXPECT_EQ(stats[0].opsRemoved(), 3);
+        EXPECT_EQ(stats[0].tensorsRemoved(), 3);
+        // the transposed copies are no longer live
+        EXPECT_GT(stats[0].bytesSaved(), 0);
+        EXPECT_EQ(stats[9].name, "data_malloc");
+        EXPECT_EQ(stats[9].opsRemoved(), 0);
+        EXPECT_NE(pm.report().find("total"), string::npos);
+    }
+
+    TEST(PassManager, EnableAndReorder)
+    {
+        Graph g = buildGraph();
+        auto pm = PassManager::standard();
+        pm.disable("optimize");
+        pm.enable("memory_aware_sort");
+        pm.setOrder({"shape_infer", "topo_sort", "memory_aware_sort",
+                     "data_malloc", "optimize", "dce", "cse",
+                     "fuse_sibling_matmuls", "fold_constants",
+                     "prepack_weights", "fuse_element_wise"});
+        pm.run(*g);
+        auto &stats = pm.getStats();
+        ASSERT_EQ(stats.size(), 10u);
+        EXPECT_EQ(stats[2].name, "memory_aware_sort");
+        EXPECT_EQ(g->getOperators().size(), 4u);
+
+        EXPECT_THROW(pm.disable("fuse"), Exception);
+        EXPECT_THROW(pm.setOrder({"optimize"}), Exception);
+        EXPECT_THROW(pm.addPass("optimize", [](GraphObj &) {}), Exception);
+    }
+
+    TEST(PassManager, PeakOfOutOfOrderOperators)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor x = g->addTensor({64, 16}, DataType::Float32);
+        Tensor w1 = g->addTensor({16, 64}, DataType::Float32);
+        Tensor b = g->addTensor({64}, DataType::Float32);
+        Tensor w2 = g->addTensor({64, 16}, DataType::Float32);
+        for (auto &w : {w1, b, w2})
+            w->setConstant();
+        auto m1 = g->addOp<MatmulObj>(x, w1, nullptr);
+        auto add = g->addOp<AddObj>(m1->getOutput(), b, nullptr);
+        g->addOp<MatmulObj>(add->getOutput(), w2, nullptr);
+
+        auto pm = PassManager::standard();
+        pm.run(*g);
+        auto &stats = pm.getStats();
+        ASSERT_EQ(stats[0].name, "optimize");
+        EXPECT_EQ(stats[0].opsRemoved(), 1);
+        // the add is fused into the first matmul, which is appended after
+        // the second one: the peak is still that of x, the hidden tensor
+        // and the output in topological order
+        size_t small = 64 * 16 * 4, large = 64 * 64 * 4;
+        EXPECT_EQ(stats[0].peakBefore, 2 * large);
+        EXPECT_EQ(stats[0].peakAfter, small + large);
+        EXPECT_EQ(stats[0].bytesSaved(), (long long)(large - small));
+        for (size_t i = 1; i < stats.size(); ++i)
+        {
+            EXPECT_EQ(stats[i].peakBefore, stats[i - 1].peakAfter);
+            EXPECT_EQ(stats[i].bytesSaved(), 0);
+        }
+        EXPECT_EQ(stats.back().peakAfter, g->estimatePeak());
+    }
+}
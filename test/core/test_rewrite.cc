@@ -0,0 +1,626 @@
+#include "core/graph.h"
+#include "core/rewrite_rules.h"
+#include "core/runtime.h"
+#include "operators/concat.h"
+#include "operators/element_wise.h"
+#include "operators/fused_element_wise.h"
+#include "operators/matmul.h"
+#include "operators/transpose.h"
+#include "operators/unary.h"
+
+#include "test.h"
+
+namespace infini
+{
+    TEST(Rewrite, Fixpoint)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor i = g->addTensor({2, 3, 4}, DataType::Float32);
+        Tensor t1 = g->addTensor({3, 4, 2}, DataType::Float32);
+        Tensor t2 = g->addTensor({4, 2, 3}, DataType::Float32);
+        Tensor t3 = g->addTensor({3, 4, 2}, DataType::Float32);
+        Tensor t4 = g->addTensor({2, 3, 4}, DataType::Float32);
+        Tensor o = g->addTensor({2, 3, 4}, DataType::Float32);
+        // composed pairwise down to the identity
+        g->addOpWithOutputs<TransposeObj>(i, t1, Shape{1, 2, 0});
+        g->addOpWithOutputs<TransposeObj>(t1, t2, Shape{1, 2, 0});
+        g->addOpWithOutputs<TransposeObj>(t2, t3, Shape{2, 0, 1});
+        g->addOpWithOutputs<TransposeObj>(t3, t4, Shape{2, 0, 1});
+        g->addOpWithOutputs<ReluObj>(t4, o);
+
+        GraphRewriter rewriter;
+        rewriter.addRule<ComposeTransposeRule>();
+        EXPECT_EQ(rewriter.run(*g), 3u);
+        EXPECT_EQ(rewriter.getCounts().at("ComposeTranspose"), 3u);
+        ASSERT_EQ(g->getOperators().size(), 1u);
+        auto relu = g->getOperators()[0];
+        EXPECT_EQ(relu->getInputs(0), i);
+        EXPECT_TRUE(relu->getPredecessors().empty());
+        EXPECT_EQ(i->getTargets(), OpVec{relu});
+        EXPECT_EQ(g->getTensors(), (TensorVec{i, o}));
+        EXPECT_TRUE(g->checkValid());
+    }
+
+    TEST(Rewrite, SharedTranspose)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor a = g->addTensor({2, 4, 3}, DataType::Float32);
+        Tensor b = g->addTensor({2, 4, 5}, DataType::Float32);
+        Tensor t = g->addTensor({2, 3, 4}, DataType::Float32);
+        Tensor o = g->addTensor({2, 3, 5}, DataType::Float32);
+        Tensor r = g->addTensor({2, 3, 4}, DataType::Float32);
+        auto transpose = g->addOpWithOutputs<TransposeObj>(a, t, Shape{0, 2, 1});
+        auto matmul = g->addOpWithOutputs<MatmulObj>(t, b, o);
+        auto relu = g->addOpWithOutputs<ReluObj>(t, r);
+        g->optimize();
+
+        // the matmul reads `a` directly, the relu still needs the transpose
+        EXPECT_TRUE(matmul->getTransA());
+        EXPECT_EQ(matmul->getInputs(0), a);
+        EXPECT_TRUE(matmul->getPredecessors().empty());
+        EXPECT_EQ(transpose->getSuccessors(), OpVec{relu});
+        EXPECT_EQ(t->getTargets(), OpVec{relu});
+        EXPECT_EQ(g->getOperators().size(), 3u);
+        EXPECT_TRUE(g->checkValid());
+    }
+
+    TEST(Rewrite, ReplaceDoubleRead)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor x = g->addTensor({2, 3}, DataType::Float32);
+        Tensor w = g->addTensor({2, 3}, DataType::Float32);
+        auto relu = g->addOp<ReluObj>(x, nullptr);
+        auto y = relu->getOutput();
+        auto add = g->addOp<AddObj>(y, y, nullptr);
+        auto other = g->addOp<ReluObj>(w, nullptr);
+        g->replaceAllUses(y, other->getOutput());
+
+        // one target per read
+        EXPECT_EQ(add->getInputs(), (TensorVec{other->getOutput(),
+                                               other->getOutput()}));
+        EXPECT_EQ(other->getOutput()->getTargets(), (OpVec{add, add}));
+        EXPECT_TRUE(y->getTargets().empty());
+        EXPECT_EQ(add->getPredecessors(), OpVec{other});
+        g->eraseOperator(relu);
+        EXPECT_TRUE(g->checkValid());
+
+        g->dataMalloc();
+        w->setData(IncrementalGenerator());
+        runtime->run(g);
+        EXPECT_TRUE(
+            add->getOutput()->equalData(vector<float>{0, 2, 4, 6, 8, 10}));
+    }
+
+    TEST(Rewrite, TransposeToReshape)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        // a weight keeps its shape, so its dims of 1 can move for free
+        Tensor i = g->addTensor({1, 3, 1, 4}, DataType::Float32);
+        i->setWeight();
+        auto moveOnes = g->addOp<TransposeObj>(i, nullptr, Shape{2, 1, 0, 3});
+        auto identity = g->addOp<TransposeObj>(moveOnes->getOutput(), nullptr,
+                                               Shape{0, 1, 2, 3});
+        auto relu = g->addOp<ReluObj>(identity->getOutput(), nullptr);
+        auto swap = g->addOp<TransposeObj>(relu->getOutput(), nullptr,
+                                           Shape{0, 3, 1, 2});
+        Tensor o = swap->getOutput();
+        g->optimize();
+
+        ASSERT_TRUE(g->topo_sort());
+        ASSERT_EQ(g->getOperators().size(), 3u);
+        EXPECT_EQ(g->getOperators()[0]->getOpType(), OpType::Reshape);
+        EXPECT_EQ(relu->getInputs(0), moveOnes->getOutput());
+        EXPECT_EQ(g->getOperators()[2]->getOpType(), OpType::Transpose);
+        EXPECT_TRUE(g->checkValid());
+
+        g->dataMalloc();
+        i->setData(IncrementalGenerator());
+        runtime->run(g);
+        EXPECT_TRUE(o->equalData(vector<float>{0, 4, 8, 1, 5, 9, 2, 6, 10,
+                                               3, 7, 11}));
+    }
+
+    TEST(Rewrite, TransposeOfResizableInput)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor x = g->addTensor({1, 3, 1, 4}, DataType::Float32);
+        auto moveOnes = g->addOp<TransposeObj>(x, nullptr, Shape{2, 1, 0, 3});
+        auto identity = g->addOp<ClipObj>(moveOnes->getOutput(), nullptr,
+                                          std::nullopt, std::nullopt);
+        Tensor o = identity->getOutput();
+        g->optimize();
+
+        // the batch of 1 may grow, so the move stays a transpose, and the
+        // identity kept for the output follows the input shape
+        ASSERT_TRUE(g->topo_sort());
+        ASSERT_EQ(g->getOperators().size(), 2u);
+        EXPECT_EQ(g->getOperators()[0]->getOpType(), OpType::Transpose);
+        EXPECT_EQ(g->getOperators()[1]->getOpType(), OpType::Reshape);
+
+        g->setInputShapes({{2, 3, 1, 4}});
+        EXPECT_EQ(o->getDims(), (Shape{1, 3, 2, 4}));
+        x->setData(IncrementalGenerator());
+        runtime->run(g);
+        EXPECT_TRUE(o->equalData(vector<float>{
+            0, 1, 2, 3, 12, 13, 14, 15, 4, 5, 6, 7,
+            16, 17, 18, 19, 8, 9, 10, 11, 20, 21, 22, 23}));
+    }
+
+    TEST(Rewrite, SinkTranspose)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        {
+            // cancels with the transpose after the relu
+            Graph g = make_ref<GraphObj>(runtime);
+            Tensor i = g->addTensor({2, 3, 4}, DataType::Float32);
+            auto t1 = g->addOp<TransposeObj>(i, nullptr, Shape{1, 0, 2});
+            auto relu = g->addOp<ReluObj>(t1->getOutput(), nullptr);
+            auto t2 = g->addOp<TransposeObj>(relu->getOutput(), nullptr,
+                                             Shape{1, 0, 2});
+            g->optimize();
+            for (auto &op : g->getOperators())
+                EXPECT_NE(op->getOpType(), OpType::Transpose);
+            EXPECT_EQ(g->getOutputs(), TensorVec{t2->getOutput()});
+            EXPECT_TRUE(g->checkValid());
+        }
+        {
+            // folded into the matmul
+            Graph g = make_ref<GraphObj>(runtime);
+            Tensor a = g->addTensor({2, 4, 3}, DataType::Float32);
+            Tensor b = g->addTensor({2, 4, 5}, DataType::Float32);
+            auto t = g->addOp<TransposeObj>(a, nullptr, Shape{0, 2, 1});
+            auto relu = g->addOp<ReluObj>(t->getOutput(), nullptr);
+            auto matmul = g->addOp<MatmulObj>(relu->getOutput(), b, nullptr);
+            g->optimize();
+            EXPECT_EQ(g->getOperators().size(), 2u);
+            EXPECT_TRUE(matmul->getTransA());
+            auto source = matmul->getInputs(0)->getSource();
+            ASSERT_NE(source, nullptr);
+            EXPECT_EQ(source->getOpType(), OpType::Relu);
+            EXPECT_EQ(source->getInputs(0), a);
+            EXPECT_TRUE(g->checkValid());
+        }
+        {
+            // stays where it is when nothing absorbs it
+            Graph g = make_ref<GraphObj>(runtime);
+            Tensor i = g->addTensor({2, 3, 4}, DataType::Float32);
+            auto t = g->addOp<TransposeObj>(i, nullptr, Shape{1, 0, 2});
+            auto relu = g->addOp<ReluObj>(t->getOutput(), nullptr);
+            g->optimize();
+            EXPECT_EQ(relu->getInputs(0), t->getOutput());
+        }
+    }
+
+    TEST(Rewrite, MergeTransposes)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor a = g->addTensor({2, 3}, DataType::Float32);
+        Tensor b = g->addTensor({2, 3}, DataType::Float32);
+        Tensor c = g->addTensor({2, 2}, DataType::Float32);
+        auto ta = g->addOp<TransposeObj>(a, nullptr, Shape{1, 0});
+        auto tb = g->addOp<TransposeObj>(b, nullptr, Shape{1, 0});
+        auto tc = g->addOp<TransposeObj>(c, nullptr, Shape{1, 0});
+        auto add = g->addOp<AddObj>(ta->getOutput(), tb->getOutput(), nullptr);
+        auto concat = g->addOp<ConcatObj>(
+            TensorVec{add->getOutput(), tc->getOutput()}, nullptr, 0);
+        Tensor o = concat->getOutput();
+        g->optimize();
+
+        // Add and Concat both run untransposed, followed by one transpose
+        int transposes = 0;
+        for (auto &op : g->getOperators())
+            transposes += op->getOpType() == OpType::Transpose;
+        EXPECT_EQ(transposes, 1);
+        EXPECT_EQ(o->getSource()->getOpType(), OpType::Transpose);
+        EXPECT_TRUE(g->checkValid());
+
+        g->dataMalloc();
+        a->setData(IncrementalGenerator());
+        b->setData(IncrementalGenerator());
+        c->setData(IncrementalGenerator());
+        runtime->run(g);
+        // a + b is {{0, 2, 4}, {6, 8, 10}}, c is {{0, 1}, {2, 3}}
+        EXPECT_TRUE(
+            o->equalData(vector<float>{0, 6, 2, 8, 4, 10, 0, 2, 1, 3}));
+    }
+
+    TEST(Rewrite, FoldPermutationIntoMatmul)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        // attention-style head transposes, run with and without optimize()
+        auto build = [&](Tensor &out) {
+            Graph g = make_ref<GraphObj>(runtime);
+            Tensor q = g->addTensor({2, 3, 4, 5}, DataType::Float32);
+            Tensor k = g->addTensor({2, 6, 4, 5}, DataType::Float32);
+            auto tq = g->addOp<TransposeObj>(q, nullptr, Shape{0, 2, 1, 3});
+            auto tk = g->addOp<TransposeObj>(k, nullptr, Shape{0, 2, 3, 1});
+            auto matmul = g->addOp<MatmulObj>(tq->getOutput(),
+                                              tk->getOutput(), nullptr);
+            out = matmul->getOutput();
+            return g;
+        };
+        Tensor expected, actual;
+        Graph ref = build(expected);
+        Graph g = build(actual);
+        g->optimize();
+        ASSERT_EQ(g->getOperators().size(), 1u);
+        auto matmul = as<MatmulObj>(g->getOperators()[0]);
+        EXPECT_EQ(matmul->getPermA(), (vector<int>{0, 2, 1, 3}));
+        EXPECT_EQ(matmul->getPermB(), (vector<int>{0, 2, 3, 1}));
+        EXPECT_FALSE(matmul->getTransB());
+
+        for (auto graph : {ref, g})
+        {
+            graph->dataMalloc();
+            for (auto &input : graph->getInputs())
+                input->setData(IncrementalGenerator());
+            runtime->run(graph);
+        }
+        EXPECT_EQ(actual->getDims(), (Shape{2, 4, 3, 6}));
+        EXPECT_TRUE(actual->equalData(expected));
+    }
+
+    TEST(Rewrite, FoldTransposeIntoBothMatmulInputs)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        // t^T * t^T, with both inputs reading the same transpose
+        auto build = [&](Tensor &out) {
+            Graph g = make_ref<GraphObj>(runtime);
+            Tensor x = g->addTensor({3, 3}, DataType::Float32);
+            auto t = g->addOp<TransposeObj>(x, nullptr, Shape{1, 0});
+            out = g->addOp<MatmulObj>(t->getOutput(), t->getOutput(), nullptr)
+                      ->getOutput();
+            return g;
+        };
+        Tensor expected, actual;
+        Graph ref = build(expected);
+        Graph g = build(actual);
+        g->optimize();
+        ASSERT_EQ(g->getOperators().size(), 1u);
+        auto matmul = as<MatmulObj>(g->getOperators()[0]);
+        EXPECT_TRUE(matmul->getTransA());
+        EXPECT_TRUE(matmul->getTransB());
+        EXPECT_TRUE(g->checkValid());
+
+        for (auto graph : {ref, g})
+        {
+            graph->dataMalloc();
+            graph->getInputs()[0]->setData(IncrementalGenerator());
+            runtime->run(graph);
+        }
+        EXPECT_TRUE(actual->equalData(expected));
+        EXPECT_TRUE(actual->equalData(
+            vector<float>{15, 42, 69, 18, 54, 90, 21, 66, 111}));
+    }
+
+    TEST(Rewrite, FuseMatmulEpilogue)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor x = g->addTensor({2, 3}, DataType::Float32);
+        Tensor w = g->addTensor({3, 2}, DataType::Float32);
+        Tensor b = g->addTensor({1, 2}, DataType::Float32);
+        auto matmul = g->addOp<MatmulObj>(x, w, nullptr);
+        auto add = g->addOp<AddObj>(b, matmul->getOutput(), nullptr);
+        auto clip = g->addOp<ClipObj>(add->getOutput(), nullptr, 12.f, 30.f);
+        Tensor o = clip->getOutput();
+        g->optimize();
+
+        ASSERT_EQ(g->getOperators().size(), 1u);
+        auto fused = as<MatmulObj>(g->getOperators()[0]);
+        EXPECT_EQ(fused->getBias(), b);
+        EXPECT_EQ(fused->getAct(), ActType::Clip);
+        EXPECT_EQ(fused->getOutput(), o);
+        EXPECT_EQ(g->getTensors().size(), 4u);
+        EXPECT_TRUE(g->checkValid());
+
+        g->dataMalloc();
+        x->setData(IncrementalGenerator());
+        w->setData(IncrementalGenerator());
+        b->setData(IncrementalGenerator());
+        runtime->run(g);
+        // {10, 13, 28, 40} plus {0, 1}, clamped to [12, 30]
+        EXPECT_TRUE(o->equalData(vector<float>{12, 14, 28, 30}));
+    }
+
+    TEST(Rewrite, FuseElementWiseChain)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        // more elements than one block of the fused kernel, with a
+        // broadcast input
+        auto build = [&](Tensor &out) {
+            Graph g = make_ref<GraphObj>(runtime);
+            Tensor x = g->addTensor({3, 300}, DataType::Float32);
+            Tensor y = g->addTensor({300}, DataType::Float32);
+            Tensor z = g->addTensor({3, 300}, DataType::Float32);
+            auto add = g->addOp<AddObj>(x, y, nullptr);
+            auto mul = g->addOp<MulObj>(add->getOutput(), z, nullptr);
+            auto sub = g->addOp<SubObj>(mul->getOutput(), x, nullptr);
+            auto relu = g->addOp<ReluObj>(sub->getOutput(), nullptr);
+            auto clip = g->addOp<ClipObj>(relu->getOutput(), nullptr,
+                                          std::nullopt, 100000.f);
+            out = clip->getOutput();
+            return g;
+        };
+        Tensor expected, actual;
+        Graph ref = build(expected);
+        Graph g = build(actual);
+        EXPECT_EQ(g->fuse_element_wise(), 4u);
+        ASSERT_EQ(g->getOperators().size(), 1u);
+        auto fused = as<FusedElementWiseObj>(g->getOperators()[0]);
+        // x is read by Add and Sub through one register
+        EXPECT_EQ(fused->getInputs().size(), 3u);
+        EXPECT_EQ(fused->getProgram().size(), 5u);
+        EXPECT_EQ(fused->getOutput(), actual);
+        EXPECT_EQ(g->getTensors().size(), 4u);
+        EXPECT_TRUE(g->checkValid());
+
+        for (auto graph : {ref, g})
+        {
+            graph->dataMalloc();
+            for (auto &input : graph->getInputs())
+                input->setData(IncrementalGenerator());
+            runtime->run(graph);
+        }
+        EXPECT_TRUE(actual->equalData(expected));
+    }
+
+    TEST(Rewrite, FuseSiblingMatmuls)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        // Q/K/V style projections of the same input
+        auto build = [&](TensorVec &outs) {
+            Graph g = make_ref<GraphObj>(runtime);
+            Tensor x = g->addTensor({2, 2, 3}, DataType::Float32);
+            for (int i = 0; i < 3; ++i)
+            {
+                Tensor w = g->addTensor({4, 3}, DataType::Float32);
+                w->setConstant();
+                auto matmul = g->addOp<MatmulObj>(x, w, nullptr, false, true);
+                outs.emplace_back(matmul->getOutput());
+            }
+            g->weightMalloc();
+            for (auto &tensor : g->getTensors())
+                if (tensor->isWeight())
+                    tensor->setData(IncrementalGenerator());
+            return g;
+        };
+        TensorVec expected, actual;
+        Graph ref = build(expected);
+        Graph g = build(actual);
+        EXPECT_EQ(g->fuse_sibling_matmuls(), 1u);
+        // the weights are stacked at compile time, and only the stack stays
+        // in the store
+        g->fold_constants();
+        ASSERT_TRUE(g->topo_sort());
+        auto &ops = g->getOperators();
+        ASSERT_EQ(ops.size(), 2u);
+        auto fused = as<MatmulObj>(ops[0]);
+        EXPECT_EQ(fused->getInputs(1)->getDims(), (Shape{12, 3}));
+        EXPECT_TRUE(fused->getInputs(1)->isConstant());
+        EXPECT_EQ(g->getWeightStore()->numSlots(), 1u);
+        EXPECT_EQ(ops[1]->getOpType(), OpType::Split);
+        EXPECT_EQ(ops[1]->getOutputs(), actual);
+        EXPECT_TRUE(g->checkValid());
+
+        // a new batch needs no rewrite
+        for (auto graph : {ref, g})
+        {
+            graph->setInputShapes({{3, 2, 3}});
+            graph->getInputs()[0]->setData(IncrementalGenerator());
+            runtime->run(graph);
+        }
+        for (int i = 0; i < 3; ++i)
+        {
+            EXPECT_EQ(actual[i]->getDims(), (Shape{3, 2, 4}));
+            EXPECT_TRUE(actual[i]->equalData(expected[i]));
+        }
+
+        // unloaded weights would be stacked again on every run
+        Graph unloaded = make_ref<GraphObj>(runtime);
+        Tensor x = unloaded->addTensor({2, 3}, DataType::Float32);
+        for (int i = 0; i < 2; ++i)
+        {
+            Tensor w = unloaded->addTensor({3, 4}, DataType::Float32);
+            w->setConstant();
+            unloaded->addOp<MatmulObj>(x, w, nullptr);
+        }
+        EXPECT_EQ(unloaded->fuse_sibling_matmuls(), 0u);
+        EXPECT_EQ(unloaded->getOperators().size(), 2u);
+    }
+
+    TEST(Rewrite, PrepackWeights)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        auto build = [&](TensorVec &outs) {
+            Graph g = make_ref<GraphObj>(runtime);
+            Tensor x = g->addTensor({2, 3, 5}, DataType::Float32);
+            Tensor w1 = g->addTensor({16, 5}, DataType::Float32);
+            Tensor w2 = g->addTensor({5, 12}, DataType::Float32);
+            Tensor w3 = g->addTensor({5, 6}, DataType::Float32);
+            Tensor bias = g->addTensor({12}, DataType::Float32);
+            for (auto &w : {w1, w2, w3, bias})
+                w->setConstant();
+            outs.emplace_back(
+                g->addOp<MatmulObj>(x, w1, nullptr, false, true)->getOutput());
+            auto m2 = g->addOp<MatmulObj>(x, w2, nullptr, false, false,
+                                          vector<int>{}, vector<int>{}, bias);
+            m2->setAct(ActType::Relu);
+            outs.emplace_back(m2->getOutput());
+            outs.emplace_back(g->addOp<MatmulObj>(x, w3, nullptr)->getOutput());
+            // a second reader of w1
+            outs.emplace_back(
+                g->addOp<MatmulObj>(x, w1, nullptr, false, true)->getOutput());
+            g->weightMalloc();
+            for (auto &tensor : g->getTensors())
+                if (tensor->isWeight())
+                    tensor->setData(IncrementalGenerator());
+            return g;
+        };
+        TensorVec expected, actual;
+        Graph ref = build(expected);
+        Graph g = build(actual);
+        size_t weightBytes = g->getWeightStore()->getBytes();
+        // n = 6 is not a multiple of a panel width
+        EXPECT_EQ(g->prepack_weights(), 2u);
+        ASSERT_TRUE(g->topo_sort());
+        ASSERT_EQ(g->getOperators().size(), 4u);
+        // the packed weights replace the plain ones in the store
+        EXPECT_EQ(g->getWeightStore()->numSlots(), 4u);
+        EXPECT_EQ(g->getWeightStore()->getBytes(), weightBytes);
+        auto m1 = as<MatmulObj>(actual[0]->getSource());
+        EXPECT_EQ(m1->getPanelB(), 8);
+        EXPECT_FALSE(m1->getTransB());
+        EXPECT_EQ(m1->getInputs(1)->getDims(), (Shape{2, 5, 8}));
+        EXPECT_TRUE(m1->getInputs(1)->isConstant());
+        auto m2 = as<MatmulObj>(actual[1]->getSource());
+        EXPECT_EQ(m2->getPanelB(), 4);
+        EXPECT_EQ(m2->getInputs(1)->getDims(), (Shape{3, 5, 4}));
+        EXPECT_EQ(as<MatmulObj>(actual[2]->getSource())->getPanelB(), 0);
+        EXPECT_EQ(actual[3]->getSource()->getInputs(1), m1->getInputs(1));
+        EXPECT_TRUE(g->checkValid());
+
+        for (auto graph : {ref, g})
+        {
+            graph->dataMalloc();
+            graph->getInputs()[0]->setData(IncrementalGenerator());
+            runtime->run(graph);
+        }
+        for (int i = 0; i < 4; ++i)
+            EXPECT_TRUE(actual[i]->equalData(expected[i]));
+
+        // weights that are not loaded cannot be folded, and would be packed
+        // again on every run
+        Graph unloaded = make_ref<GraphObj>(runtime);
+        Tensor x = unloaded->addTensor({2, 5}, DataType::Float32);
+        Tensor w = unloaded->addTensor({5, 8}, DataType::Float32);
+        w->setConstant();
+        unloaded->addOp<MatmulObj>(x, w, nullptr);
+        EXPECT_EQ(unloaded->prepack_weights(), 0u);
+        EXPECT_EQ(unloaded->getOperators().size(), 1u);
+    }
+
+    TEST(Rewrite, AlgebraicSimplification)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor x = g->addTensor({2, 3}, DataType::Float32);
+        Tensor one = g->addTensor({1}, DataType::Float32);
+        // ones only: x may change shape with setInputShapes()
+        Tensor zero = g->addTensor({1, 1}, DataType::Float32);
+        one->setConstant();
+        zero->setConstant();
+        g->weightMalloc();
+        one->setData(OneGenerator());
+        zero->setData(ZeroGenerator());
+
+        auto relu = g->addOp<ReluObj>(x, nullptr);
+        auto clip1 = g->addOp<ClipObj>(relu->getOutput(), nullptr, -1.f, 6.f);
+        auto clip2 = g->addOp<ClipObj>(clip1->getOutput(), nullptr,
+                                       std::nullopt, 4.f);
+        auto mul = g->addOp<MulObj>(clip2->getOutput(), one, nullptr);
+        auto add = g->addOp<AddObj>(zero, mul->getOutput(), nullptr);
+        auto clip3 = g->addOp<ClipObj>(add->getOutput(), nullptr, std::nullopt,
+                                       std::nullopt);
+        auto cast = g->addOp<CastObj>(clip3->getOutput(), nullptr,
+                                      CastType::Float2Float);
+        auto relu2 = g->addOp<ReluObj>(cast->getOutput(), nullptr);
+        Tensor o = relu2->getOutput();
+        g->optimize();
+
+        ASSERT_EQ(g->getOperators().size(), 1u);
+        auto clip = as<ClipObj>(g->getOperators()[0]);
+        EXPECT_EQ(clip->getOpType(), OpType::Clip);
+        EXPECT_EQ(clip->getInputs(0), x);
+        EXPECT_EQ(clip->getOutput(), o);
+        EXPECT_EQ(clip->getMin(), 0.f);
+        EXPECT_EQ(clip->getMax(), 4.f);
+        EXPECT_FALSE(g->hasTensor(one));
+        EXPECT_TRUE(g->checkValid());
+
+        g->dataMalloc();
+        x->setData(IncrementalGenerator());
+        runtime->run(g);
+        EXPECT_TRUE(o->equalData(vector<float>{0, 1, 2, 3, 4, 4}));
+    }
+
+    TEST(Rewrite, RemoveIdentityReadTwice)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor x = g->addTensor({2, 3}, DataType::Float32);
+        Tensor one = g->addTensor({1}, DataType::Float32);
+        one->setConstant();
+        g->weightMalloc();
+        one->setData(OneGenerator());
+        auto mul = g->addOp<MulObj>(x, one, nullptr);
+        auto add = g->addOp<AddObj>(mul->getOutput(), mul->getOutput(),
+                                    nullptr);
+        auto clip = g->addOp<ClipObj>(add->getOutput(), nullptr, std::nullopt,
+                                      std::nullopt);
+        auto sub = g->addOp<SubObj>(clip->getOutput(), clip->getOutput(),
+                                    nullptr);
+        auto sum = g->addOp<AddObj>(add->getOutput(), sub->getOutput(),
+                                    nullptr);
+        g->optimize();
+
+        EXPECT_EQ(g->getOperators().size(), 3u);
+        EXPECT_EQ(add->getInputs(), (TensorVec{x, x}));
+        EXPECT_EQ(sub->getInputs(),
+                  (TensorVec{add->getOutput(), add->getOutput()}));
+        EXPECT_TRUE(g->checkValid());
+
+        g->dataMalloc();
+        x->setData(IncrementalGenerator());
+        runtime->run(g);
+        EXPECT_TRUE(
+            sum->getOutput()->equalData(vector<float>{0, 2, 4, 6, 8, 10}));
+    }
+
+    TEST(Rewrite, KeepIdentityOfResizableInput)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor x = g->addTensor({4, 3}, DataType::Float32);
+        Tensor zero = g->addTensor({4, 3}, DataType::Float32);
+        zero->setConstant();
+        g->weightMalloc();
+        zero->setData(ZeroGenerator());
+        auto add = g->addOp<AddObj>(x, zero, nullptr);
+        auto relu = g->addOp<ReluObj>(add->getOutput(), nullptr);
+        Tensor o = relu->getOutput();
+        g->optimize();
+
+        // a batch of 1 still broadcasts to the 4 rows of zero
+        EXPECT_EQ(g->getOperators().size(), 2u);
+        g->setInputShapes({{1, 3}});
+        EXPECT_EQ(o->getDims(), (Shape{4, 3}));
+    }
+
+    TEST(Rewrite, CastRoundTrip)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor x = g->addTensor({4}, DataType::Int32);
+        // Int64 holds every Int32, Float does not
+        auto wide = g->addOp<CastObj>(x, nullptr, CastType::Int322Int64);
+        auto back = g->addOp<CastObj>(wide->getOutput(), nullptr,
+                                      CastType::Int642Int32);
+        auto lossy = g->addOp<CastObj>(back->getOutput(), nullptr,
+                                       CastType::Int322Float);
+        auto truncated = g->addOp<CastObj>(lossy->getOutput(), nullptr,
+                                           CastType::Float2Int32);
+        auto relu = g->addOp<ReluObj>(truncated->getOutput(), nullptr);
+        g->optimize();
+
+        EXPECT_EQ(g->getOperators(), (OpVec{lossy, truncated, relu}));
+        EXPECT_EQ(lossy->getInputs(0), x);
+        EXPECT_TRUE(g->checkValid());
+    }
+}
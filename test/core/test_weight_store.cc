@@ -0,0 +1,106 @@
+#include "core/graph.h"
+#include "core/runtime.h"
+#include "core/weight_store.h"
+#include "operators/element_wise.h"
+
+#include "test.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace infini
+{
+    TEST(WeightStore, SeparateFromArena)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor i = g->addTensor({2, 3}, DataType::Float32);
+        Tensor w = g->addTensor({2, 3}, DataType::Float32);
+        w->setWeight();
+        auto op = g->addOp<AddObj>(i, w, nullptr);
+        g->dataMalloc();
+        auto store = g->getWeightStore();
+        EXPECT_EQ(store->numSlots(), 1u);
+        EXPECT_EQ(w->getRawDataPtr<void *>(), store->getPtr(0));
+
+        i->setData(IncrementalGenerator());
+        w->setData(OneGenerator());
+        runtime->run(g);
+        EXPECT_TRUE(op->getOutput()->equalData(vector<float>{1, 2, 3, 4, 5, 6}));
+    }
+
+    TEST(WeightStore, ShareAndMap)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        auto build = [&](Tensor &input, Tensor &output)
+        {
+            Graph g = make_ref<GraphObj>(runtime);
+            input = g->addTensor({4}, DataType::Float32);
+            Tensor w = g->addTensor({4}, DataType::Float32);
+            w->setWeight();
+            output = g->addOp<MulObj>(input, w, nullptr)->getOutput();
+            return g;
+        };
+        Tensor i1, o1, i2, o2, i3, o3;
+        Graph g1 = build(i1, o1);
+        g1->weightMalloc();
+        g1->getTensors()[1]->setData(IncrementalGenerator());
+
+        // a second instance shares the loaded weights
+        Graph g2 = build(i2, o2);
+        g2->setWeightStore(g1->getWeightStore());
+        g2->dataMalloc();
+        EXPECT_EQ(g2->getTensors()[1]->getRawDataPtr<void *>(),
+                  g1->getTensors()[1]->getRawDataPtr<void *>());
+        i2->setData(OneGenerator());
+        runtime->run(g2);
+        EXPECT_TRUE(o2->equalData(vector<float>{0, 1, 2, 3}));
+
+        // a third one maps them read-only from a file
+        string path = testing::TempDir() + "weight_store_test.bin";
+        g1->getWeightStore()->save(path);
+        Graph g3 = build(i3, o3);
+        g3->setWeightStore(WeightStoreObj::load(runtime, path));
+        g3->dataMalloc();
+        EXPECT_TRUE(g3->getWeightStore()->isReadOnly(0));
+        i3->setData(OneGenerator());
+        runtime->run(g3);
+        EXPECT_TRUE(o3->equalData(vector<float>{0, 1, 2, 3}));
+        std::remove(path.c_str());
+    }
+
+    TEST(WeightStore, LoadCorruptFile)
+    {
+        Runtime runtime = NativeCpuRuntimeObj::getInstance();
+        auto store = make_ref<WeightStoreObj>(runtime);
+        store->reserve(16);
+        store->materialize();
+        string path = testing::TempDir() + "weight_store_corrupt.bin";
+        store->save(path);
+        std::ifstream in(path, std::ios::binary);
+        vector<char> valid{std::istreambuf_iterator<char>(in), {}};
+        in.close();
+        EXPECT_EQ(WeightStoreObj::load(runtime, path)->numSlots(), 1u);
+
+        // header: magic, slot count, then the size of every slot
+        auto loadWith = [&](size_t word, uint64_t value)
+        {
+            vector<char> data = valid;
+            std::memcpy(data.data() + word * sizeof(uint64_t), &value,
+                        sizeof(value));
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            out.write(data.data(), data.size());
+            out.close();
+            return WeightStoreObj::load(runtime, path);
+        };
+        // (2 + count) * 8 wraps around to 16
+        EXPECT_THROW(loadWith(1, uint64_t(1) << 61), Exception);
+        EXPECT_THROW(loadWith(1, 2), Exception);
+        // offset + bytes wraps around
+        EXPECT_THROW(loadWith(2, UINT64_MAX - 8), Exception);
+        EXPECT_THROW(loadWith(2, valid.size()), Exception);
+        std::remove(path.c_str());
+    }
+} // namespace infini
@@ -0,0 +1,95 @@
+#include "core/graph.h"
+#include "core/runtime.h"
+#include "operators/matmul.h"
+#include "operators/split.h"
+#include "operators/transpose.h"
+#include "operators/unary.h"
+
+#include "test.h"
+
+namespace infini {
+
+using ExpectOutput = vector<float>;
+void testMatmulNativeCpu(
+    const std::function<void(void *, size_t, DataType)> &generatorA,
+    const std::function<void(void *, size_t, DataType)> &generatorB,
+    const Shape &shapeA, const Shape &shapeB, bool transA, bool transB,
+    const vector<int> &permA, const ExpectOutput &ansVec) {
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    Graph g = make_ref<GraphObj>(runtime);
+    auto a = g->addTensor(shapeA, DataType::Float32);
+    auto b = g->addTensor(shapeB, DataType::Float32);
+
+    auto op = g->addOp<MatmulObj>(a, b, nullptr, transA, transB, permA);
+    g->dataMalloc();
+    a->setData(generatorA);
+    b->setData(generatorB);
+
+    runtime->run(g);
+    EXPECT_TRUE(op->getOutput()->equalData(ansVec));
+}
+
+TEST(Matmul, NativeCpu) {
+    testMatmulNativeCpu(IncrementalGenerator(), IncrementalGenerator(),
+                        Shape{2, 3}, Shape{3, 2}, false, false, {},
+                        ExpectOutput{10, 13, 28, 40});
+    testMatmulNativeCpu(IncrementalGenerator(), IncrementalGenerator(),
+                        Shape{2, 3}, Shape{2, 3}, false, true, {},
+                        ExpectOutput{5, 14, 14, 50});
+    // B is broadcast over the batch
+    testMatmulNativeCpu(IncrementalGenerator(), OneGenerator(),
+                        Shape{2, 2, 3}, Shape{1, 3, 1}, false, false, {},
+                        ExpectOutput{3, 12, 21, 30});
+    // A is read as {2, 2, 3} from its {2, 3, 2} layout
+    testMatmulNativeCpu(IncrementalGenerator(), OneGenerator(),
+                        Shape{2, 3, 2}, Shape{3, 1}, false, false, {0, 2, 1},
+                        ExpectOutput{6, 9, 24, 27});
+}
+
+TEST(Matmul, NativeCpuEpilogue) {
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    Graph g = make_ref<GraphObj>(runtime);
+    auto a = g->addTensor({2, 3}, DataType::Float32);
+    auto b = g->addTensor({3, 2}, DataType::Float32);
+    auto bias = g->addTensor({2}, DataType::Float32);
+    auto op =
+        g->addOp<MatmulObj>(a, b, nullptr, false, false,
+                            vector<int>{}, vector<int>{}, bias);
+    op->setAct(ActType::Clip, std::nullopt, 30.f);
+    EXPECT_EQ(op->getBias(), bias);
+    g->dataMalloc();
+    a->setData(IncrementalGenerator());
+    b->setData(IncrementalGenerator());
+    bias->setData(IncrementalGenerator());
+
+    runtime->run(g);
+    // {10, 13, 28, 40} plus the bias {0, 1}, clamped to 30
+    EXPECT_TRUE(op->getOutput()->equalData(ExpectOutput{10, 14, 28, 30}));
+}
+
+TEST(Matmul, NativeCpuStridedBias) {
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    Graph g = make_ref<GraphObj>(runtime);
+    auto a = g->addTensor({2, 2}, DataType::Float32);
+    auto b = g->addTensor({2, 3}, DataType::Float32);
+    auto c = g->addTensor({3, 2}, DataType::Float32);
+    auto r = g->addOp<ReluObj>(c, nullptr)->getOutput();
+    auto column =
+        g->addOp<SplitObj>(r, std::nullopt, 1, vector<int>{1, 1})->getOutput(1);
+    // the second column of r, viewed as a row
+    auto bias =
+        g->addOp<TransposeObj>(column, nullptr, Shape{1, 0})->getOutput();
+    auto op = g->addOp<MatmulObj>(a, b, nullptr, false, false, vector<int>{},
+                                  vector<int>{}, bias);
+    g->dataMalloc();
+    EXPECT_FALSE(bias->isContiguous());
+    a->setData(IncrementalGenerator());
+    b->setData(IncrementalGenerator());
+    c->setData(IncrementalGenerator());
+
+    runtime->run(g);
+    // {3, 4, 5, 9, 14, 19} plus the bias {1, 3, 5}
+    EXPECT_TRUE(op->getOutput()->equalData(ExpectOutput{4, 7, 10, 10, 17, 24}));
+}
+
+} // namespace infini
@@ -0,0 +1,42 @@
+#include "core/graph.h"
+#include "core/runtime.h"
+#include "operators/split.h"
+
+#include "test.h"
+
+namespace infini {
+
+TEST(Split, NativeCpu) {
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    Graph g = make_ref<GraphObj>(runtime);
+
+    auto i = g->addTensor({2, 3, 2}, DataType::Float32);
+    auto op = g->addOp<SplitObj>(i, std::nullopt, 1, vector<int>{2, 1});
+    g->dataMalloc();
+    i->setData(IncrementalGenerator());
+
+    runtime->run(g);
+    EXPECT_TRUE(
+        op->getOutput(0)->equalData(vector<float>{0, 1, 2, 3, 6, 7, 8, 9}));
+    EXPECT_TRUE(op->getOutput(1)->equalData(vector<float>{4, 5, 10, 11}));
+}
+
+TEST(Split, NativeCpuInPlace) {
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    Graph g = make_ref<GraphObj>(runtime);
+
+    auto i = g->addTensor({1, 3, 2}, DataType::Float32);
+    auto op = g->addOp<SplitObj>(i, std::nullopt, 1, vector<int>{1, 2});
+    g->dataMalloc();
+    // the pieces are placed in the memory of the input
+    auto base = i->getRawDataPtr<float *>();
+    EXPECT_EQ(op->getOutput(0)->getRawDataPtr<float *>(), base);
+    EXPECT_EQ(op->getOutput(1)->getRawDataPtr<float *>(), base + 2);
+    i->setData(IncrementalGenerator());
+
+    runtime->run(g);
+    EXPECT_TRUE(op->getOutput(0)->equalData(vector<float>{0, 1}));
+    EXPECT_TRUE(op->getOutput(1)->equalData(vector<float>{2, 3, 4, 5}));
+}
+
+} // namespace infini
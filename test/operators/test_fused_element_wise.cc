@@ -0,0 +1,35 @@
+#include "core/graph.h"
+#include "core/kernel.h"
+#include "core/runtime.h"
+#include "operators/fused_element_wise.h"
+
+#include "test.h"
+
+namespace infini {
+
+TEST(FusedElementWise, ShapeInference) {
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    {
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor a = g->addTensor({2, 1, 4}, DataType::Float32);
+        Tensor b = g->addTensor({3, 1}, DataType::Float32);
+        // relu(a * b + a)
+        auto op = g->addOp<FusedElementWiseObj>(
+            TensorVec{a, b}, nullptr,
+            vector<FusedInstr>{{OpType::Mul, 0, 1, {}, {}},
+                               {OpType::Add, 2, 0, {}, {}},
+                               {OpType::Relu, 3, -1, {}, {}}});
+        EXPECT_EQ(op->getOutput()->getDims(), (Shape{2, 3, 4}));
+    }
+    {
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor a = g->addTensor({2, 3}, DataType::Float32);
+        // register 1 is not written yet
+        EXPECT_THROW(g->addOp<FusedElementWiseObj>(
+                         TensorVec{a}, nullptr,
+                         vector<FusedInstr>{{OpType::Add, 0, 1, {}, {}}}),
+                     Exception);
+    }
+}
+
+} // namespace infini
@@ -0,0 +1,25 @@
+#include "core/graph.h"
+#include "core/kernel.h"
+#include "core/runtime.h"
+#include "operators/reshape.h"
+
+#include "test.h"
+
+namespace infini {
+
+TEST(Reshape, ShapeInference) {
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    {
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor i = g->addTensor({1, 2, 3, 4}, DataType::Float32);
+        auto op = g->addOp<ReshapeObj>(i, nullptr, Shape{6, 4});
+        EXPECT_EQ(op->getOutput()->getDims(), (Shape{6, 4}));
+    }
+    {
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor i = g->addTensor({2, 3}, DataType::Float32);
+        EXPECT_THROW(g->addOp<ReshapeObj>(i, nullptr, Shape{4, 2}), Exception);
+    }
+}
+
+} // namespace infini
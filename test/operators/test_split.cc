@@ -0,0 +1,31 @@
+#include "core/graph.h"
+#include "core/kernel.h"
+#include "core/runtime.h"
+#include "operators/split.h"
+
+#include "test.h"
+
+namespace infini {
+
+TEST(Split, ShapeInference) {
+    Runtime runtime = NativeCpuRuntimeObj::getInstance();
+    {
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor i = g->addTensor({2, 5, 3}, DataType::Float32);
+        auto op = g->addOp<SplitObj>(i, std::nullopt, -2, vector<int>{1, 4});
+        ASSERT_EQ(op->numOutputs(), 2);
+        EXPECT_EQ(op->getDim(), 1);
+        EXPECT_EQ(op->getOutput(0)->getDims(), (Shape{2, 1, 3}));
+        EXPECT_EQ(op->getOutput(1)->getDims(), (Shape{2, 4, 3}));
+        EXPECT_FALSE(op->isContiguous());
+    }
+    {
+        Graph g = make_ref<GraphObj>(runtime);
+        Tensor i = g->addTensor({2, 5, 3}, DataType::Float32);
+        EXPECT_THROW(
+            g->addOp<SplitObj>(i, std::nullopt, 1, vector<int>{2, 2}),
+            Exception);
+    }
+}
+
+} // namespace infini